@@ -0,0 +1,140 @@
+/***************************************************************************/ /**
+   @file         arena.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <string.h>
+#include "arena.h"
+
+/**
+ * Allocates a new arena block that can hold at least the given number of bytes.
+ *
+ * @param size The minimum usable size of the block.
+ * @return A pointer to the new block.
+ */
+static ArenaBlock *new_arena_block(size_t size)
+{
+    if (size < ARENA_BLOCK_SIZE)
+    {
+        size = ARENA_BLOCK_SIZE;
+    }
+
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + size);
+    if (block == NULL)
+    {
+        perror("Error allocating memory for arena");
+        exit(EXIT_FAILURE);
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/**
+ * Initializes an empty arena. The first block is allocated on first use.
+ *
+ * @return A pointer to the initialized arena.
+ */
+arena_t *init_arena()
+{
+    arena_t *arena = (arena_t *)malloc(sizeof(arena_t));
+    if (arena == NULL)
+    {
+        perror("Error allocating memory for arena");
+        exit(EXIT_FAILURE);
+    }
+
+    arena->head = NULL;
+    return arena;
+}
+
+/**
+ * Allocates memory from an arena. The memory is suitably aligned for any type
+ * and stays valid until the arena is reset.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return A pointer to the allocated memory.
+ */
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    const size_t align = alignof(max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+
+    ArenaBlock *block = arena->head;
+    if (block == NULL || block->size - block->used < size)
+    {
+        block = new_arena_block(size);
+        block->next = arena->head;
+        arena->head = block;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+/**
+ * Duplicates a string into an arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param str The string to duplicate.
+ * @return A pointer to the copy of the string.
+ */
+char *arena_strdup(arena_t *arena, const char *str)
+{
+    size_t length = strlen(str) + 1;
+    char *copy = arena_alloc(arena, length);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+/**
+ * Releases every allocation made from an arena in one step.
+ * The most recent block is kept so the next line does not have to allocate again.
+ *
+ * @param arena The arena to reset.
+ */
+void arena_reset(arena_t *arena)
+{
+    ArenaBlock *block = arena->head;
+    if (block == NULL)
+    {
+        return;
+    }
+
+    ArenaBlock *next = block->next;
+    while (next != NULL)
+    {
+        ArenaBlock *tmp = next->next;
+        free(next);
+        next = tmp;
+    }
+
+    block->next = NULL;
+    block->used = 0;
+}
+
+/**
+ * Frees the memory allocated for an arena and all of its blocks.
+ *
+ * @param arena The arena to be freed.
+ */
+void free_arena(arena_t *arena)
+{
+    if (arena)
+    {
+        arena_reset(arena);
+        free(arena->head);
+        free(arena);
+    }
+}
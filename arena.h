@@ -0,0 +1,44 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         arena.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stddef.h>
+
+// Macros
+#define ARENA_BLOCK_SIZE 16384
+
+/**
+ * @struct ArenaBlock
+ * @brief A block of memory that arena allocations are carved from.
+ */
+typedef struct ArenaBlock
+{
+  struct ArenaBlock *next;           /**< The previously filled block. */
+  size_t size;                       /**< The usable size of the block. */
+  size_t used;                       /**< The number of bytes handed out from the block. */
+  _Alignas(max_align_t) char data[]; /**< The memory of the block, aligned like malloc() memory. */
+} ArenaBlock;
+
+/**
+ * @struct Arena
+ * @brief A bump allocator for memory that lives until the end of an input line.
+ *
+ * Allocations are never freed one by one, the whole arena is reset in one step instead.
+ */
+typedef struct Arena
+{
+  ArenaBlock *head; /**< The block currently allocated from. */
+} arena_t;
+
+// Function Prototypes
+arena_t *init_arena();
+void *arena_alloc(arena_t *arena, size_t size);
+char *arena_strdup(arena_t *arena, const char *str);
+void arena_reset(arena_t *arena);
+void free_arena(arena_t *arena);
@@ -0,0 +1,91 @@
+/***************************************************************************/ /**
+   @file         builtin_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Runs a 10k line echo script through ./main, with the echo builtin and with
+   /bin/echo, and reports the wall time of every run.
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "harness.h"
+
+// Macros
+#define LINES 10000
+#define RUNS 3
+#define SCRIPT_FILE "bench/builtin_bench.sh"
+
+/**
+ * Writes a script of echo lines using the given command, terminated by "exit".
+ */
+static void write_script(const char *echo)
+{
+    FILE *fp = fopen(SCRIPT_FILE, "w");
+    if (fp == NULL)
+    {
+        perror(SCRIPT_FILE);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < LINES; i++)
+    {
+        fprintf(fp, "%s line %d of the benchmark > /dev/null\n", echo, i);
+    }
+    fprintf(fp, "exit\n");
+    fclose(fp);
+}
+
+/**
+ * Runs the script through the shell and returns the elapsed time in milliseconds.
+ */
+static double run_script()
+{
+    double start = harness_now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int in = open(SCRIPT_FILE, O_RDONLY);
+        int out = open("/dev/null", O_WRONLY);
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        execl("./main", "main", (char *)NULL);
+        _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+
+    return (harness_now_ns() - start) / 1e6;
+}
+
+/**
+ * Writes the script for an echo command and reports the wall time of every run of it.
+ */
+static void measure(const char *echo, const char *name)
+{
+    double samples[RUNS];
+    char params[64];
+
+    write_script(echo);
+    for (int r = 0; r < RUNS; r++)
+    {
+        samples[r] = run_script();
+    }
+
+    snprintf(params, sizeof(params), "lines=%d echo=%s", LINES, name);
+    harness_report("builtin", params, "ms", samples, RUNS);
+}
+
+int main()
+{
+    measure("echo", "builtin");
+    measure("/bin/echo", "bin_echo");
+
+    unlink(SCRIPT_FILE);
+    return 0;
+}
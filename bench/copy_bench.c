@@ -0,0 +1,154 @@
+/***************************************************************************/ /**
+   @file         copy_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Measures the throughput of copying a large file with copy_fd() (kernel
+   transfer), with a read/write loop, and through ./main with "cat in > out"
+   (in-process copy) versus "/bin/cat in > out". The file size in MB is taken
+   from COPY_BENCH_MB (default 2048), the files live in COPY_BENCH_DIR
+   (default the current directory). Every way is run COPY_BENCH_RUNS times
+   (default 3), the page cache stays warm between runs.
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../copy.h"
+#include "harness.h"
+
+// Macros
+#define MAX_RUNS 100
+
+/**
+ * Writes a file of the given size.
+ */
+static void make_file(const char *path, size_t mb)
+{
+    static char block[1 << 20];
+    memset(block, 'x', sizeof(block));
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+    {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < mb; i++)
+    {
+        if (write(fd, block, sizeof(block)) != (ssize_t)sizeof(block))
+        {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);
+}
+
+/**
+ * Copies a file with a copy function and returns the throughput in MB/s.
+ */
+static double measure_copy(ssize_t (*copy)(int, int), const char *in, const char *out, size_t mb)
+{
+    int in_fd = open(in, O_RDONLY);
+    int out_fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    double start = harness_now_ns();
+    ssize_t copied = copy(in_fd, out_fd);
+    double elapsed = (harness_now_ns() - start) / 1e9;
+
+    close(in_fd);
+    close(out_fd);
+
+    if (copied != (ssize_t)(mb << 20))
+    {
+        fprintf(stderr, "copy_bench: copied %zd of %zu bytes\n", copied, mb << 20);
+    }
+
+    return mb / elapsed;
+}
+
+/**
+ * Runs a command line through ./main -c and returns the throughput in MB/s.
+ */
+static double measure_shell(const char *command, size_t mb)
+{
+    double start = harness_now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execl("./main", "main", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+
+    return mb / ((harness_now_ns() - start) / 1e9);
+}
+
+/**
+ * Reports the throughput of every run of one way of copying.
+ */
+static void report(const char *method, size_t mb, double *samples, int runs)
+{
+    char params[64];
+    snprintf(params, sizeof(params), "mb=%zu method=%s", mb, method);
+    harness_report("copy", params, "mbps", samples, runs);
+}
+
+int main()
+{
+    const char *env_mb = getenv("COPY_BENCH_MB");
+    const char *env_dir = getenv("COPY_BENCH_DIR");
+    const char *env_runs = getenv("COPY_BENCH_RUNS");
+    size_t mb = env_mb != NULL ? strtoul(env_mb, NULL, 10) : 2048;
+    const char *dir = env_dir != NULL ? env_dir : ".";
+    int runs = env_runs != NULL ? atoi(env_runs) : 3;
+    if (runs < 1 || runs > MAX_RUNS)
+    {
+        runs = 3;
+    }
+
+    char in[4096], out[4096], command[2 * 4096 + 16];
+    double samples[MAX_RUNS];
+    snprintf(in, sizeof(in), "%s/copy_bench.in", dir);
+    snprintf(out, sizeof(out), "%s/copy_bench.out", dir);
+
+    make_file(in, mb);
+
+    for (int r = 0; r < runs; r++)
+    {
+        samples[r] = measure_copy(copy_fd, in, out, mb);
+    }
+    report("copy_fd", mb, samples, runs);
+
+    for (int r = 0; r < runs; r++)
+    {
+        samples[r] = measure_copy(copy_fd_rw, in, out, mb);
+    }
+    report("read_write", mb, samples, runs);
+
+    snprintf(command, sizeof(command), "cat %s > %s", in, out);
+    for (int r = 0; r < runs; r++)
+    {
+        samples[r] = measure_shell(command, mb);
+    }
+    report("dsh_cat", mb, samples, runs);
+
+    snprintf(command, sizeof(command), "/bin/cat %s > %s", in, out);
+    for (int r = 0; r < runs; r++)
+    {
+        samples[r] = measure_shell(command, mb);
+    }
+    report("dsh_bin_cat", mb, samples, runs);
+
+    unlink(in);
+    unlink(out);
+    return 0;
+}
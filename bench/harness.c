@@ -0,0 +1,108 @@
+/***************************************************************************/ /**
+   @file         harness.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Shared helpers of the benchmarks: a monotonic clock, a seeded random
+   generator for reproducible inputs, and a report of the distribution of
+   the samples as one "name key=value..." line, so results of different
+   commits can be compared with scripts/bench_compare.sh.
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "harness.h"
+
+/**
+ * Returns the current monotonic time in nanoseconds.
+ */
+double harness_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Returns the next number of a xorshift32 sequence.
+ *
+ * @param state The state of the sequence, start it with HARNESS_SEED.
+ */
+uint32_t harness_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * Returns a percentile of sorted samples, by the nearest rank.
+ *
+ * @param sorted The samples, in ascending order.
+ * @param count The number of samples.
+ * @param percentile The percentile, from 0 to 100.
+ */
+double harness_percentile(const double *sorted, int count, double percentile)
+{
+    int rank = (int)(percentile / 100.0 * count + 0.5);
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    if (rank > count)
+    {
+        rank = count;
+    }
+    return sorted[rank - 1];
+}
+
+/**
+ * Compares two samples for qsort().
+ */
+static int compare_samples(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Prints the distribution of the samples of a measurement, e.g.
+ * "startup case=batch samples=100 min_us=... p50_us=... p90_us=... p99_us=... max_us=... mean_us=...".
+ * The samples are sorted in place.
+ *
+ * @param name The name of the measurement.
+ * @param params The parameters of the measurement as "key=value" pairs, or NULL.
+ * @param unit The unit of the samples, used as the suffix of the keys.
+ * @param samples The samples.
+ * @param count The number of samples.
+ */
+void harness_report(const char *name, const char *params, const char *unit, double *samples, int count)
+{
+    if (count == 0)
+    {
+        printf("%s%s%s samples=0\n", name, params ? " " : "", params ? params : "");
+        return;
+    }
+
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += samples[i];
+    }
+    qsort(samples, count, sizeof(double), compare_samples);
+
+    printf("%s%s%s samples=%d min_%s=%.3f p50_%s=%.3f p90_%s=%.3f p99_%s=%.3f max_%s=%.3f mean_%s=%.3f\n",
+           name, params ? " " : "", params ? params : "", count,
+           unit, samples[0],
+           unit, harness_percentile(samples, count, 50),
+           unit, harness_percentile(samples, count, 90),
+           unit, harness_percentile(samples, count, 99),
+           unit, samples[count - 1],
+           unit, sum / count);
+    fflush(stdout);
+}
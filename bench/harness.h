@@ -0,0 +1,20 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         harness.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdint.h>
+
+// Macros
+#define HARNESS_SEED 42 // Seed of the generated inputs, so every run measures the same work
+
+// Function Prototypes
+double harness_now_ns(void);
+uint32_t harness_random(uint32_t *state);
+double harness_percentile(const double *sorted, int count, double percentile);
+void harness_report(const char *name, const char *params, const char *unit, double *samples, int count);
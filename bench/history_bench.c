@@ -0,0 +1,55 @@
+/***************************************************************************/ /**
+   @file         history_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Measures the cost of linenoiseHistoryAdd() on a full history for growing
+   history caps. With the ring buffer history the cost per add stays flat.
+   Every batch of adds is one sample of the cost per add.
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include "../linenoise.h"
+#include "harness.h"
+
+// Macros
+#define BATCHES 100
+#define ADDS_PER_BATCH 1000
+
+int main()
+{
+    const int caps[] = {1000, 10000, 100000, 1000000};
+    double samples[BATCHES];
+    char line[64], params[32];
+    long serial = 0;
+
+    for (size_t i = 0; i < sizeof(caps) / sizeof(caps[0]); i++)
+    {
+        linenoiseHistorySetMaxLen(caps[i]);
+
+        // Fill the history so every measured add evicts the oldest entry
+        while (linenoiseHistoryLength() < caps[i])
+        {
+            snprintf(line, sizeof(line), "echo %ld", serial++);
+            linenoiseHistoryAdd(line);
+        }
+
+        for (int b = 0; b < BATCHES; b++)
+        {
+            double start = harness_now_ns();
+            for (int j = 0; j < ADDS_PER_BATCH; j++)
+            {
+                snprintf(line, sizeof(line), "echo %ld", serial++);
+                linenoiseHistoryAdd(line);
+            }
+            samples[b] = (harness_now_ns() - start) / ADDS_PER_BATCH;
+        }
+
+        snprintf(params, sizeof(params), "cap=%d", caps[i]);
+        harness_report("history_add", params, "ns", samples, BATCHES);
+    }
+
+    return 0;
+}
@@ -0,0 +1,643 @@
+/***************************************************************************/ /**
+   @file         hotpath_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Measures the shell's hot paths and prints percentiles for each:
+   - startup of ./main in batch mode, and in interactive mode with a 10k and a
+     100k line history (load_config, linenoiseHistoryLoad, history index);
+   - tokenize and parse time per line of a script of long lines;
+   - start-up and wait latency of /bin/true and of the true builtin;
+   - throughput of a two stage pipeline;
+   - hint and completion lookups against 10k and 100k line histories;
+   - building the PATH executable index, and command name completions;
+   - reading a 100k file directory, and path completions from its cached listing;
+   - Ctrl-R fuzzy search per keystroke against a 200k line history.
+   The shell runs in a scratch directory with its own .dshrc, and timings per
+   line are taken from its --profile output. Inputs are generated from a fixed
+   seed. HOTPATH_BENCH_RUNS scales the number of samples (default 1).
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include "harness.h"
+#include "../linenoise.h"
+#include "../history.h"
+#include "../cmdindex.h"
+#include "../dircache.h"
+#include "../fuzzy.h"
+
+// Macros
+#define STARTUP_RUNS 50
+#define PARSE_LINES 1000
+#define PARSE_WORDS 200
+#define SPAWN_LINES 500
+#define PIPELINE_LINES 8
+#define PIPELINE_MB 256
+#define HINT_LOOKUPS 20000
+#define COMPLETION_LOOKUPS 2000
+#define INDEX_BUILDS 20
+#define LISTING_FILES 100000
+#define LISTING_READS 10
+#define SEARCH_HISTORY 200000
+#define SEARCH_QUERIES 500
+#define SEARCH_QUERY_LENGTH 6
+
+/**
+ * @brief The scratch directory and the shell under test.
+ */
+static char scratch[] = "/tmp/dsh_bench.XXXXXX";
+static char shell[4096];
+static int runs = 1;
+
+/**
+ * @brief Words the generated history lines are made of.
+ */
+static const char *commands[] = {"git", "ls", "cd", "make", "grep", "cat", "vim", "docker", "kubectl", "ssh", "python3", "cargo"};
+static const char *arguments[] = {"status", "-la", "src", "build", "--all", "commit", "push", "main.c", "logs", "-n", "test", "deploy", "origin", "/var/log", "README.md", "pods"};
+
+/**
+ * Returns the path of a file in the scratch directory.
+ */
+static const char *scratch_path(const char *name)
+{
+    static char path[2][4096];
+    static int next = 0;
+    next ^= 1;
+    snprintf(path[next], sizeof(path[next]), "%s/%s", scratch, name);
+    return path[next];
+}
+
+/**
+ * Opens a file of the scratch directory for writing.
+ */
+static FILE *create(const char *name)
+{
+    FILE *fp = fopen(scratch_path(name), "w");
+    if (fp == NULL)
+    {
+        perror(name);
+        exit(EXIT_FAILURE);
+    }
+    return fp;
+}
+
+/**
+ * Writes a history file of generated command lines.
+ */
+static void write_history(const char *name, int lines)
+{
+    uint32_t seed = HARNESS_SEED;
+    FILE *fp = create(name);
+
+    for (int i = 0; i < lines; i++)
+    {
+        fprintf(fp, "%s", commands[harness_random(&seed) % (sizeof(commands) / sizeof(commands[0]))]);
+
+        int count = 1 + harness_random(&seed) % 4;
+        for (int j = 0; j < count; j++)
+        {
+            fprintf(fp, " %s", arguments[harness_random(&seed) % (sizeof(arguments) / sizeof(arguments[0]))]);
+        }
+        fprintf(fp, " %u\n", harness_random(&seed) % 1000);
+    }
+
+    fclose(fp);
+}
+
+/**
+ * Writes the .dshrc of the scratch directory.
+ *
+ * @param history The history file.
+ * @param history_size The number of history lines kept.
+ * @param completion Whether tab completion, and so the history index, is on.
+ * @param format The history format, "text" or "binary".
+ */
+static void write_config(const char *history, int history_size, bool completion, const char *format)
+{
+    FILE *fp = create(".dshrc");
+    fprintf(fp, "TAB_COMPLETION = %s\nHISTORY_FILE = %s\nHISTORY_SIZE = %d\nHISTORY_FORMAT = %s\nSCRIPT_CACHE = false\n",
+            completion ? "true" : "false", history, history_size, format);
+    fclose(fp);
+}
+
+/**
+ * Runs the shell in the scratch directory with stdin and stdout on /dev/null.
+ *
+ * @param args The arguments of the shell, NULL terminated, without the program name.
+ * @return The wall time in microseconds.
+ */
+static double run_shell(const char **args)
+{
+    const char *argv[8] = {"main"};
+    for (int i = 0; args[i] != NULL && i < 6; i++)
+    {
+        argv[i + 1] = args[i];
+    }
+
+    double start = harness_now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null_fd = open("/dev/null", O_RDWR);
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        if (chdir(scratch) == -1)
+        {
+            _exit(127);
+        }
+        execv(shell, (char **)argv);
+        _exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127)
+    {
+        fprintf(stderr, "hotpath_bench: %s did not run\n", shell);
+        exit(EXIT_FAILURE);
+    }
+
+    return (harness_now_ns() - start) / 1e3;
+}
+
+/**
+ * Reads a field of every record of a --profile JSON Lines file.
+ *
+ * @param fields The fields to add up per record, e.g. {"exec_us", "wait_us", NULL}.
+ * @param samples Receives the sum of the fields of every record.
+ * @param capacity The size of the samples array.
+ * @return The number of records.
+ */
+static int read_profile(const char **fields, double *samples, int capacity)
+{
+    FILE *fp = fopen(scratch_path("profile.jsonl"), "r");
+    char line[8192];
+    int count = 0;
+
+    while (fp != NULL && count < capacity && fgets(line, sizeof(line), fp) != NULL)
+    {
+        // The command is written first and may be truncated, the timings are at the end
+        double sum = 0;
+        char key[64];
+        for (int i = 0; fields[i] != NULL; i++)
+        {
+            snprintf(key, sizeof(key), "\"%s\":", fields[i]);
+            char *value = strstr(line, key);
+            sum += value != NULL ? atof(value + strlen(key)) : 0;
+        }
+        samples[count++] = sum;
+    }
+
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+    return count;
+}
+
+/**
+ * Runs a script with --profile and reports fields of its per-line records.
+ */
+static void profile_script(const char *script, const char *name, const char *params, const char **fields, int lines)
+{
+    double *samples = malloc(sizeof(double) * lines * runs);
+    int count = 0;
+
+    for (int r = 0; r < runs; r++)
+    {
+        run_shell((const char *[]){"--profile", "profile.jsonl", script, NULL});
+        count += read_profile(fields, samples + count, lines);
+    }
+
+    harness_report(name, params, "us", samples, count);
+    free(samples);
+}
+
+/**
+ * Measures the startup of the shell in batch mode and in interactive mode with large histories.
+ */
+static void bench_startup(void)
+{
+    int count = STARTUP_RUNS * runs;
+    double *samples = malloc(sizeof(double) * count);
+
+    write_config("history_0", 100000, true, "text");
+    for (int i = 0; i < count; i++)
+    {
+        samples[i] = run_shell((const char *[]){"-c", "true", NULL});
+    }
+    harness_report("startup", "case=batch", "us", samples, count);
+
+    const int sizes[] = {0, 10000, 100000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        char history[32], params[64];
+        snprintf(history, sizeof(history), "history_%d", sizes[s]);
+        snprintf(params, sizeof(params), "case=interactive history=%d", sizes[s]);
+        write_config(history, 100000, true, "text");
+
+        for (int i = 0; i < count; i++)
+        {
+            samples[i] = run_shell((const char *[]){NULL});
+        }
+        harness_report("startup", params, "us", samples, count);
+    }
+
+    // Loading the history alone, without the history index built for completion. The
+    // first binary run imports the text history, it is not measured.
+    const char *formats[] = {"text", "binary"};
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        char params[64];
+        snprintf(params, sizeof(params), "case=history_load format=%s history=100000", formats[f]);
+        write_config("history_100000", 100000, false, formats[f]);
+
+        run_shell((const char *[]){NULL});
+        for (int i = 0; i < count; i++)
+        {
+            samples[i] = run_shell((const char *[]){NULL});
+        }
+        harness_report("startup", params, "us", samples, count);
+    }
+
+    free(samples);
+}
+
+/**
+ * Measures tokenize and parse time per line on long lines.
+ */
+static void bench_parse(void)
+{
+    uint32_t seed = HARNESS_SEED;
+    FILE *fp = create("parse.dsh");
+
+    for (int i = 0; i < PARSE_LINES; i++)
+    {
+        fprintf(fp, "true");
+        for (int j = 0; j < PARSE_WORDS; j++)
+        {
+            uint32_t r = harness_random(&seed);
+            fprintf(fp, r % 16 == 0 ? " ; true" : " %s", arguments[r % (sizeof(arguments) / sizeof(arguments[0]))]);
+        }
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+
+    char params[64];
+    snprintf(params, sizeof(params), "words=%d", PARSE_WORDS);
+    profile_script("parse.dsh", "tokenize", params, (const char *[]){"tokenize_us", NULL}, PARSE_LINES);
+    profile_script("parse.dsh", "parse", params, (const char *[]){"parse_us", NULL}, PARSE_LINES);
+}
+
+/**
+ * Measures the latency of starting and waiting for a trivial command.
+ */
+static void bench_spawn(void)
+{
+    FILE *fp = create("spawn.dsh");
+    for (int i = 0; i < SPAWN_LINES; i++)
+    {
+        fprintf(fp, "/bin/true\n");
+    }
+    fclose(fp);
+
+    fp = create("builtin.dsh");
+    for (int i = 0; i < SPAWN_LINES; i++)
+    {
+        fprintf(fp, "true\n");
+    }
+    fclose(fp);
+
+    profile_script("spawn.dsh", "exec", "case=bin_true", (const char *[]){"exec_us", "wait_us", NULL}, SPAWN_LINES);
+    profile_script("builtin.dsh", "exec", "case=builtin_true", (const char *[]){"exec_us", "wait_us", NULL}, SPAWN_LINES);
+}
+
+/**
+ * Measures the throughput of a two stage pipeline.
+ */
+static void bench_pipeline(void)
+{
+    FILE *fp = create("pipeline.dsh");
+    for (int i = 0; i < PIPELINE_LINES; i++)
+    {
+        fprintf(fp, "head -c %d /dev/zero | /bin/cat > /dev/null\n", PIPELINE_MB << 20);
+    }
+    fclose(fp);
+
+    double *samples = malloc(sizeof(double) * PIPELINE_LINES * runs);
+    int count = 0;
+
+    for (int r = 0; r < runs; r++)
+    {
+        run_shell((const char *[]){"--profile", "profile.jsonl", "pipeline.dsh", NULL});
+        count += read_profile((const char *[]){"total_us", NULL}, samples + count, PIPELINE_LINES);
+    }
+
+    // Throughput in MB/s, from the time of each line
+    for (int i = 0; i < count; i++)
+    {
+        samples[i] = PIPELINE_MB / (samples[i] / 1e6);
+    }
+
+    char params[64];
+    snprintf(params, sizeof(params), "stages=2 mb=%d", PIPELINE_MB);
+    harness_report("pipeline", params, "mbps", samples, count);
+    free(samples);
+}
+
+/**
+ * Measures hint and completion lookups against a history, in a child process so every
+ * history size starts from an empty history.
+ */
+static void bench_lookups(int size)
+{
+    char history[32];
+    snprintf(history, sizeof(history), "history_%d", size);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid != 0)
+    {
+        waitpid(pid, NULL, 0);
+        return;
+    }
+
+    linenoiseHistorySetMaxLen(size);
+    linenoiseHistoryLoad(scratch_path(history));
+    history_index_load(scratch_path(history));
+
+    int count = HINT_LOOKUPS * runs;
+    double *samples = malloc(sizeof(double) * count);
+    uint32_t seed = HARNESS_SEED;
+    char prefix[64], params[64];
+
+    // Prefixes of history lines, the way they are typed
+    for (int i = 0; i < count; i++)
+    {
+        const char *line = linenoiseHistoryGet(harness_random(&seed) % linenoiseHistoryLength());
+        size_t length = 1 + harness_random(&seed) % (strlen(line) < 24 ? strlen(line) : 24);
+        snprintf(prefix, sizeof(prefix), "%.*s", (int)length, line);
+
+        double start = harness_now_ns();
+        volatile const char *hint = history_index_hint(prefix);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+        (void)hint;
+    }
+    snprintf(params, sizeof(params), "history=%d", size);
+    harness_report("hints", params, "us", samples, count);
+
+    count = COMPLETION_LOOKUPS * runs;
+    for (int i = 0; i < count; i++)
+    {
+        const char *line = linenoiseHistoryGet(harness_random(&seed) % linenoiseHistoryLength());
+        size_t length = 1 + harness_random(&seed) % (strlen(line) < 24 ? strlen(line) : 24);
+        snprintf(prefix, sizeof(prefix), "%.*s", (int)length, line);
+
+        linenoiseCompletions lc = {0, NULL};
+        double start = harness_now_ns();
+        history_index_complete(prefix, &lc);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+
+        for (size_t j = 0; j < lc.len; j++)
+        {
+            free(lc.cvec[j]);
+        }
+        free(lc.cvec);
+    }
+    harness_report("completion", params, "us", samples, count);
+
+    exit(0);
+}
+
+/**
+ * Frees the completions of a lookup.
+ */
+static void free_completions(linenoiseCompletions *lc)
+{
+    for (size_t j = 0; j < lc->len; j++)
+    {
+        free(lc->cvec[j]);
+    }
+    free(lc->cvec);
+}
+
+/**
+ * Measures building the PATH executable index and completing command names from it.
+ */
+static void bench_command_index(void)
+{
+    int count = INDEX_BUILDS * runs;
+    double *samples = malloc(sizeof(double) * COMPLETION_LOOKUPS * runs);
+    char params[64];
+
+    // The first completion builds the index
+    for (int i = 0; i < count; i++)
+    {
+        linenoiseCompletions lc = {0, NULL};
+        free_command_index();
+
+        double start = harness_now_ns();
+        command_index_complete("x", 0, &lc);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+
+        free_completions(&lc);
+    }
+    snprintf(params, sizeof(params), "case=build names=%zu", command_index_count());
+    harness_report("command_index", params, "us", samples, count);
+
+    // Later ones only check the directories and search, with one or two letter prefixes
+    uint32_t seed = HARNESS_SEED;
+    count = COMPLETION_LOOKUPS * runs;
+    for (int i = 0; i < count; i++)
+    {
+        char prefix[3] = {'a' + harness_random(&seed) % 26, i % 2 ? 'a' + harness_random(&seed) % 26 : '\0', '\0'};
+        linenoiseCompletions lc = {0, NULL};
+
+        double start = harness_now_ns();
+        command_index_complete(prefix, 0, &lc);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+
+        free_completions(&lc);
+    }
+    snprintf(params, sizeof(params), "case=lookup names=%zu", command_index_count());
+    harness_report("command_index", params, "us", samples, count);
+
+    free(samples);
+}
+
+/**
+ * Returns the name of a file of the generated directory, e.g. "app-00042.log".
+ */
+static const char *listing_name(int i)
+{
+    static char name[32];
+    snprintf(name, sizeof(name), "listing/%s-%05d.log", commands[i % (sizeof(commands) / sizeof(commands[0]))], i);
+    return name;
+}
+
+/**
+ * Measures reading a large directory and completing file names from its cached listing.
+ */
+static void bench_dir_cache(void)
+{
+    char directory[4096], params[64];
+    snprintf(directory, sizeof(directory), "%s", scratch_path("listing"));
+    mkdir(directory, 0755);
+    for (int i = 0; i < LISTING_FILES; i++)
+    {
+        close(open(scratch_path(listing_name(i)), O_WRONLY | O_CREAT, 0644));
+    }
+
+    // A directory modified within the last second is read on every lookup, so it is backdated
+    struct timespec times[2] = {{0, UTIME_OMIT}, {1, 0}};
+    utimensat(AT_FDCWD, directory, times, 0);
+
+    int count = LISTING_READS * runs;
+    double *samples = malloc(sizeof(double) * COMPLETION_LOOKUPS * runs);
+    for (int i = 0; i < count; i++)
+    {
+        free_dir_cache();
+
+        double start = harness_now_ns();
+        dir_cache_count(directory);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+    }
+    snprintf(params, sizeof(params), "case=read files=%zu", dir_cache_count(directory));
+    harness_report("dir_cache", params, "us", samples, count);
+
+    // Repeated Tabs on the prefix of a command word, which matches about a tenth of the files
+    uint32_t seed = HARNESS_SEED;
+    count = COMPLETION_LOOKUPS * runs;
+    for (int i = 0; i < count; i++)
+    {
+        char line[4200];
+        snprintf(line, sizeof(line), "cat %s/%.*s", directory,
+                 1 + (int)(harness_random(&seed) % 3), commands[harness_random(&seed) % (sizeof(commands) / sizeof(commands[0]))]);
+        linenoiseCompletions lc = {0, NULL};
+
+        double start = harness_now_ns();
+        dir_cache_complete(line, 4, "/", &lc);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+
+        free_completions(&lc);
+    }
+    snprintf(params, sizeof(params), "case=complete files=%d", LISTING_FILES);
+    harness_report("dir_cache", params, "us", samples, count);
+
+    free(samples);
+    free_dir_cache();
+    for (int i = 0; i < LISTING_FILES; i++)
+    {
+        unlink(scratch_path(listing_name(i)));
+    }
+    rmdir(directory);
+}
+
+/**
+ * Measures Ctrl-R searches against a large history, one search per typed character of
+ * queries made of characters picked in order from history lines, in a child process.
+ */
+static void bench_fuzzy_search(void)
+{
+    char history[32], params[64];
+    snprintf(history, sizeof(history), "history_%d", SEARCH_HISTORY);
+    write_history(history, SEARCH_HISTORY);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid != 0)
+    {
+        waitpid(pid, NULL, 0);
+        unlink(scratch_path(history));
+        return;
+    }
+
+    linenoiseHistorySetMaxLen(SEARCH_HISTORY);
+    linenoiseHistoryLoad(scratch_path(history));
+    history_index_load(scratch_path(history));
+
+    int count = 0;
+    double *samples = malloc(sizeof(double) * SEARCH_QUERIES * SEARCH_QUERY_LENGTH * runs);
+    uint32_t seed = HARNESS_SEED;
+
+    for (int i = 0; i < SEARCH_QUERIES * runs; i++)
+    {
+        const char *line = linenoiseHistoryGet(harness_random(&seed) % linenoiseHistoryLength());
+        size_t length = strlen(line);
+        char query[SEARCH_QUERY_LENGTH + 1] = {0};
+
+        for (size_t j = 0, at = 0; j < SEARCH_QUERY_LENGTH && at < length; j++)
+        {
+            while (at < length && line[at] == ' ')
+            {
+                at++;
+            }
+            if (at == length)
+            {
+                break;
+            }
+            query[j] = line[at];
+            at += 1 + harness_random(&seed) % 3;
+
+            linenoiseCompletions lc = {0, NULL};
+            double start = harness_now_ns();
+            fuzzy_index_search(query, &lc);
+            samples[count++] = (harness_now_ns() - start) / 1e3;
+
+            free_completions(&lc);
+        }
+    }
+
+    snprintf(params, sizeof(params), "history=%zu case=keystroke", fuzzy_index_count());
+    harness_report("fuzzy_search", params, "us", samples, count);
+
+    exit(0);
+}
+
+int main()
+{
+    const char *env_runs = getenv("HOTPATH_BENCH_RUNS");
+    runs = env_runs != NULL && atoi(env_runs) > 0 ? atoi(env_runs) : 1;
+
+    if (realpath("./main", shell) == NULL || mkdtemp(scratch) == NULL)
+    {
+        perror("hotpath_bench");
+        return 1;
+    }
+
+    write_history("history_0", 0);
+    write_history("history_10000", 10000);
+    write_history("history_100000", 100000);
+    write_config("history_0", 100000, true, "text");
+
+    bench_startup();
+    write_config("history_0", 100000, true, "text");
+    bench_parse();
+    bench_spawn();
+    bench_pipeline();
+    bench_lookups(10000);
+    bench_lookups(100000);
+    bench_command_index();
+    bench_dir_cache();
+    bench_fuzzy_search();
+
+    const char *files[] = {"history_0", "history_10000", "history_100000", "history_100000.bin", ".dshrc", "profile.jsonl",
+                           "parse.dsh", "spawn.dsh", "builtin.dsh", "pipeline.dsh"};
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        unlink(scratch_path(files[i]));
+    }
+    rmdir(scratch);
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+/***************************************************************************/ /**
+   @file         pipe_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Measures the throughput of a producer and a consumer process connected by a
+   pipe, for pipe buffer sizes from the 64 KiB default up to pipe-max-size.
+   Both sides move data in 1 MiB reads and writes, like cat or dd would.
+   Every transfer of RUN_MB is one sample.
+ *******************************************************************************/
+
+#define _GNU_SOURCE
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "harness.h"
+
+// Macros
+#define RUNS 8
+#define RUN_MB 512
+#define CHUNK_SIZE (1 << 20)
+
+/**
+ * Pushes RUN_MB through a pipe of the given size and returns the throughput in MB/s.
+ */
+static double measure(int size, int *actual)
+{
+    static char buffer[CHUNK_SIZE];
+    int pipefd[2];
+
+    if (pipe(pipefd) == -1)
+    {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    fcntl(pipefd[1], F_SETPIPE_SZ, size);
+    *actual = fcntl(pipefd[1], F_GETPIPE_SZ);
+
+    double start = harness_now_ns();
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(pipefd[0]);
+        memset(buffer, 'x', sizeof(buffer));
+        for (int i = 0; i < RUN_MB; i++)
+        {
+            for (ssize_t written = 0; written < CHUNK_SIZE;)
+            {
+                ssize_t n = write(pipefd[1], buffer + written, CHUNK_SIZE - written);
+                if (n <= 0)
+                {
+                    _exit(1);
+                }
+                written += n;
+            }
+        }
+        _exit(0);
+    }
+
+    close(pipefd[1]);
+    while (read(pipefd[0], buffer, sizeof(buffer)) > 0)
+        ;
+    close(pipefd[0]);
+    waitpid(pid, NULL, 0);
+
+    return RUN_MB / ((harness_now_ns() - start) / 1e9);
+}
+
+int main()
+{
+    int max_size = 1 << 20;
+    FILE *fp = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if (fp != NULL)
+    {
+        if (fscanf(fp, "%d", &max_size) != 1)
+        {
+            max_size = 1 << 20;
+        }
+        fclose(fp);
+    }
+
+    for (int size = 64 << 10; size <= max_size; size *= 4)
+    {
+        int actual = 0;
+        double samples[RUNS];
+        char params[64];
+
+        for (int r = 0; r < RUNS; r++)
+        {
+            samples[r] = measure(size, &actual);
+        }
+
+        snprintf(params, sizeof(params), "size_kb=%d mb=%d", actual >> 10, RUN_MB);
+        harness_report("pipe", params, "mbps", samples, RUNS);
+    }
+
+    return 0;
+}
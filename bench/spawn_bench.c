@@ -0,0 +1,94 @@
+/***************************************************************************/ /**
+   @file         spawn_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Compares the latency of starting and reaping /bin/true with fork()+execv()
+   and with posix_spawn(), for a small and for a large resident heap. Every
+   launch is one sample.
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "harness.h"
+
+// Macros
+#define RUNS 500
+
+extern char **environ;
+
+/**
+ * Starts /bin/true with fork() and execv() and waits for it.
+ */
+static void run_fork(char **args)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        execv(args[0], args);
+        _exit(127);
+    }
+    waitpid(pid, NULL, 0);
+}
+
+/**
+ * Starts /bin/true with posix_spawn() and waits for it.
+ */
+static void run_spawn(char **args)
+{
+    pid_t pid;
+    if (posix_spawn(&pid, args[0], NULL, NULL, args, environ) == 0)
+    {
+        waitpid(pid, NULL, 0);
+    }
+}
+
+/**
+ * Reports the latency in microseconds of every launch with a launch function.
+ */
+static void measure(const char *params, void (*run)(char **), char **args)
+{
+    static double samples[RUNS];
+
+    for (int i = 0; i < RUNS; i++)
+    {
+        double start = harness_now_ns();
+        run(args);
+        samples[i] = (harness_now_ns() - start) / 1e3;
+    }
+
+    harness_report("spawn", params, "us", samples, RUNS);
+}
+
+int main()
+{
+    const size_t heaps_mb[] = {0, 256};
+    char *args[] = {"/bin/true", NULL};
+    char params[64];
+
+    for (size_t h = 0; h < sizeof(heaps_mb) / sizeof(heaps_mb[0]); h++)
+    {
+        // Touch the heap so its pages are resident and have to be mapped by fork()
+        size_t size = heaps_mb[h] << 20;
+        char *heap = size > 0 ? malloc(size) : NULL;
+        if (heap != NULL)
+        {
+            memset(heap, 1, size);
+        }
+
+        snprintf(params, sizeof(params), "heap_mb=%zu method=fork_exec", heaps_mb[h]);
+        measure(params, run_fork, args);
+        snprintf(params, sizeof(params), "heap_mb=%zu method=posix_spawn", heaps_mb[h]);
+        measure(params, run_spawn, args);
+
+        free(heap);
+    }
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+/***************************************************************************/ /**
+   @file         tokenize_bench.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+
+   Measures tokenize() on long argument lists, and compares the operator
+   classification table against the strcmp chain it replaced. Every run over
+   a line is one sample.
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../utils.h"
+#include "harness.h"
+
+// Macros
+#define RUNS 50
+
+/**
+ * The operator check parse_tokens() and get_args() used to run on every token.
+ */
+static bool strcmp_is_operator(const char *value)
+{
+    return strcmp(value, "|") == 0 || strcmp(value, "<") == 0 || strcmp(value, ">") == 0 || strcmp(value, "2>") == 0 || strcmp(value, ">>") == 0 || strcmp(value, "&") == 0 || strcmp(value, ";") == 0 || strcmp(value, "&&") == 0;
+}
+
+/**
+ * Builds an xargs-style command line with the given number of path arguments.
+ */
+static char *build_line(int args)
+{
+    char *line = malloc((size_t)args * 32 + 64);
+    size_t length = sprintf(line, "ls -l");
+
+    for (int i = 0; i < args; i++)
+    {
+        length += sprintf(line + length, " /var/log/app/shard-%d.log", i);
+    }
+    sprintf(line + length, " | wc -l > out.txt");
+
+    return line;
+}
+
+int main()
+{
+    const int sizes[] = {10, 1000, 10000, 100000};
+    arena_t *arena = init_arena();
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        char *line = build_line(sizes[s]);
+        size_t length = strlen(line);
+        char *input = malloc(length + 1);
+        Token *tokens = NULL;
+        size_t count = 0;
+
+        double samples[RUNS];
+        char params[64];
+
+        for (int r = 0; r < RUNS; r++)
+        {
+            memcpy(input, line, length + 1);
+            arena_reset(arena);
+
+            double start = harness_now_ns();
+            count = tokenize(input, &tokens, arena);
+            samples[r] = (harness_now_ns() - start) / 1e3;
+        }
+        snprintf(params, sizeof(params), "args=%d tokens=%zu", sizes[s], count);
+        harness_report("tokenize", params, "us", samples, RUNS);
+
+        // Classify the tokenized values both ways, the result is accumulated so it is not optimized out
+        volatile size_t operators = 0;
+        for (int r = 0; r < RUNS; r++)
+        {
+            double start = harness_now_ns();
+            for (size_t t = 0; t < count; t++)
+            {
+                operators += classify_operator(input + tokens[t].offset, tokens[t].length) != TOKEN_WORD;
+            }
+            samples[r] = (harness_now_ns() - start) / count;
+        }
+        snprintf(params, sizeof(params), "args=%d method=table", sizes[s]);
+        harness_report("classify", params, "ns", samples, RUNS);
+
+        for (int r = 0; r < RUNS; r++)
+        {
+            double start = harness_now_ns();
+            for (size_t t = 0; t < count; t++)
+            {
+                operators += strcmp_is_operator(input + tokens[t].offset);
+            }
+            samples[r] = (harness_now_ns() - start) / count;
+        }
+        snprintf(params, sizeof(params), "args=%d method=strcmp", sizes[s]);
+        harness_report("classify", params, "ns", samples, RUNS);
+
+        free(input);
+        free(line);
+    }
+
+    free_arena(arena);
+    return 0;
+}
@@ -0,0 +1,444 @@
+/***************************************************************************/ /**
+   @file         builtins.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "builtins.h"
+
+// Macros
+#define MAX_FORMAT_SPEC 64
+
+/**
+ * Prints the arguments separated by spaces. A leading "-n" suppresses the trailing newline.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+int builtin_echo(app_t *app, char **args)
+{
+    bool newline = true;
+    int i = 1;
+
+    if (args[i] != NULL && strcmp(args[i], "-n") == 0)
+    {
+        newline = false;
+        i++;
+    }
+
+    for (int first = i; args[i] != NULL; i++)
+    {
+        if (i > first)
+        {
+            putchar(' ');
+        }
+        fputs(args[i], stdout);
+    }
+
+    if (newline)
+    {
+        putchar('\n');
+    }
+
+    return 0;
+}
+
+/**
+ * Prints the current working directory.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+int builtin_pwd(app_t *app, char **args)
+{
+    char cwd[PATH_MAX];
+
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+    {
+        perror("pwd");
+        return 1;
+    }
+
+    puts(cwd);
+    return 0;
+}
+
+/**
+ * Does nothing, successfully.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+int builtin_true(app_t *app, char **args)
+{
+    return 0;
+}
+
+/**
+ * Does nothing, unsuccessfully.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+int builtin_false(app_t *app, char **args)
+{
+    return 1;
+}
+
+/**
+ * Prints the character for a backslash escape sequence.
+ *
+ * @param p A pointer to the character following the backslash.
+ * @return A pointer to the last character of the escape sequence.
+ */
+static const char *print_escape(const char *p)
+{
+    switch (*p)
+    {
+    case 'n':
+        putchar('\n');
+        break;
+    case 't':
+        putchar('\t');
+        break;
+    case 'r':
+        putchar('\r');
+        break;
+    case 'a':
+        putchar('\a');
+        break;
+    case 'b':
+        putchar('\b');
+        break;
+    case 'f':
+        putchar('\f');
+        break;
+    case 'v':
+        putchar('\v');
+        break;
+    case '\\':
+        putchar('\\');
+        break;
+    case '\0':
+        putchar('\\');
+        return p - 1;
+    default:
+        putchar('\\');
+        putchar(*p);
+        break;
+    }
+
+    return p;
+}
+
+/**
+ * Formats and prints the arguments, like printf(1). Supports the %s, %c, %d, %i, %u, %o, %x
+ * and %X conversions with flags, width and precision, and the common backslash escapes.
+ * The format is reused as long as it consumes arguments.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+int builtin_printf(app_t *app, char **args)
+{
+    if (args[1] == NULL)
+    {
+        fprintf(stderr, "printf: usage: printf format [arguments]\n");
+        return 2;
+    }
+
+    const char *format = args[1];
+    char **arg = args + 2;
+
+    do
+    {
+        char **round_start = arg;
+
+        for (const char *p = format; *p != '\0'; p++)
+        {
+            if (*p == '\\')
+            {
+                p = print_escape(p + 1);
+                continue;
+            }
+
+            if (*p != '%')
+            {
+                putchar(*p);
+                continue;
+            }
+
+            if (p[1] == '%')
+            {
+                putchar('%');
+                p++;
+                continue;
+            }
+
+            // Copy the conversion specification, leaving room for a length modifier
+            char spec[MAX_FORMAT_SPEC];
+            size_t length = 0;
+            spec[length++] = *p++;
+            while (*p != '\0' && strchr("-+ #0123456789.", *p) != NULL && length < MAX_FORMAT_SPEC - 3)
+            {
+                spec[length++] = *p++;
+            }
+
+            const char *value = *arg != NULL ? *arg++ : NULL;
+
+            switch (*p)
+            {
+            case 's':
+                spec[length++] = 's';
+                spec[length] = '\0';
+                printf(spec, value != NULL ? value : "");
+                break;
+            case 'c':
+                if (value != NULL && value[0] != '\0')
+                {
+                    spec[length++] = 'c';
+                    spec[length] = '\0';
+                    printf(spec, value[0]);
+                }
+                break;
+            case 'd':
+            case 'i':
+                spec[length++] = 'l';
+                spec[length++] = *p;
+                spec[length] = '\0';
+                printf(spec, value != NULL ? strtol(value, NULL, 0) : 0L);
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec[length++] = 'l';
+                spec[length++] = *p;
+                spec[length] = '\0';
+                printf(spec, value != NULL ? strtoul(value, NULL, 0) : 0UL);
+                break;
+            default:
+                // Unknown conversion, print it as it was written
+                fwrite(spec, 1, length, stdout);
+                if (value != NULL)
+                {
+                    arg--;
+                }
+                if (*p == '\0')
+                {
+                    p--;
+                }
+                else
+                {
+                    putchar(*p);
+                }
+                break;
+            }
+        }
+
+        if (arg == round_start)
+        {
+            break;
+        }
+    } while (*arg != NULL);
+
+    return 0;
+}
+
+/**
+ * Evaluates a unary file or string test, e.g. "-f file".
+ *
+ * @param op The operator.
+ * @param operand The operand.
+ * @param result The result of the test.
+ * @return 0 on success, -1 if the operator is unknown.
+ */
+static int unary_test(const char *op, const char *operand, bool *result)
+{
+    struct stat st;
+
+    if (strcmp(op, "-z") == 0)
+    {
+        *result = operand[0] == '\0';
+    }
+    else if (strcmp(op, "-n") == 0)
+    {
+        *result = operand[0] != '\0';
+    }
+    else if (strcmp(op, "-e") == 0)
+    {
+        *result = stat(operand, &st) == 0;
+    }
+    else if (strcmp(op, "-f") == 0)
+    {
+        *result = stat(operand, &st) == 0 && S_ISREG(st.st_mode);
+    }
+    else if (strcmp(op, "-d") == 0)
+    {
+        *result = stat(operand, &st) == 0 && S_ISDIR(st.st_mode);
+    }
+    else if (strcmp(op, "-s") == 0)
+    {
+        *result = stat(operand, &st) == 0 && st.st_size > 0;
+    }
+    else if (strcmp(op, "-L") == 0 || strcmp(op, "-h") == 0)
+    {
+        *result = lstat(operand, &st) == 0 && S_ISLNK(st.st_mode);
+    }
+    else if (strcmp(op, "-r") == 0)
+    {
+        *result = access(operand, R_OK) == 0;
+    }
+    else if (strcmp(op, "-w") == 0)
+    {
+        *result = access(operand, W_OK) == 0;
+    }
+    else if (strcmp(op, "-x") == 0)
+    {
+        *result = access(operand, X_OK) == 0;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Evaluates a binary string or integer comparison, e.g. "a = b" or "1 -lt 2".
+ *
+ * @param left The left operand.
+ * @param op The operator.
+ * @param right The right operand.
+ * @param result The result of the comparison.
+ * @return 0 on success, -1 if the operator is unknown.
+ */
+static int binary_test(const char *left, const char *op, const char *right, bool *result)
+{
+    if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0)
+    {
+        *result = strcmp(left, right) == 0;
+        return 0;
+    }
+
+    if (strcmp(op, "!=") == 0)
+    {
+        *result = strcmp(left, right) != 0;
+        return 0;
+    }
+
+    long a = strtol(left, NULL, 10);
+    long b = strtol(right, NULL, 10);
+
+    if (strcmp(op, "-eq") == 0)
+    {
+        *result = a == b;
+    }
+    else if (strcmp(op, "-ne") == 0)
+    {
+        *result = a != b;
+    }
+    else if (strcmp(op, "-lt") == 0)
+    {
+        *result = a < b;
+    }
+    else if (strcmp(op, "-le") == 0)
+    {
+        *result = a <= b;
+    }
+    else if (strcmp(op, "-gt") == 0)
+    {
+        *result = a > b;
+    }
+    else if (strcmp(op, "-ge") == 0)
+    {
+        *result = a >= b;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Evaluates a conditional expression, like test(1) and "[ ... ]". Supports a leading "!",
+ * one-argument string tests, unary file/string tests and binary comparisons.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return 0 if the expression is true, 1 if it is false, 2 on a usage error.
+ */
+int builtin_test(app_t *app, char **args)
+{
+    char **argv = args + 1;
+    int argc = 0;
+    while (argv[argc] != NULL)
+    {
+        argc++;
+    }
+
+    if (strcmp(args[0], "[") == 0)
+    {
+        if (argc == 0 || strcmp(argv[argc - 1], "]") != 0)
+        {
+            fprintf(stderr, "[: missing ']'\n");
+            return 2;
+        }
+        argc--;
+    }
+
+    bool negate = false;
+    if (argc > 0 && strcmp(argv[0], "!") == 0)
+    {
+        negate = true;
+        argv++;
+        argc--;
+    }
+
+    bool result = false;
+    int err = 0;
+
+    switch (argc)
+    {
+    case 0:
+        result = false;
+        break;
+    case 1:
+        result = argv[0][0] != '\0';
+        break;
+    case 2:
+        err = unary_test(argv[0], argv[1], &result);
+        break;
+    case 3:
+        err = binary_test(argv[0], argv[1], argv[2], &result);
+        break;
+    default:
+        fprintf(stderr, "%s: too many arguments\n", args[0]);
+        return 2;
+    }
+
+    if (err != 0)
+    {
+        fprintf(stderr, "%s: unknown operator\n", args[0]);
+        return 2;
+    }
+
+    return result != negate ? 0 : 1;
+}
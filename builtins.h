@@ -0,0 +1,34 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         builtins.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include "types.h"
+
+/**
+ * @brief A builtin command. It receives the command's NULL terminated args and returns its exit status.
+ */
+typedef int (*builtin_fn)(app_t *app, char **args);
+
+/**
+ * @struct Builtin
+ * @brief An entry of the builtin dispatch table.
+ */
+typedef struct Builtin
+{
+  const char *name; /**< The command name. */
+  builtin_fn run;   /**< The function implementing the command. */
+} builtin_t;
+
+// Function Prototypes
+int builtin_echo(app_t *app, char **args);
+int builtin_pwd(app_t *app, char **args);
+int builtin_true(app_t *app, char **args);
+int builtin_false(app_t *app, char **args);
+int builtin_printf(app_t *app, char **args);
+int builtin_test(app_t *app, char **args);
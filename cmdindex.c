@@ -0,0 +1,313 @@
+/***************************************************************************/ /**
+   @file         cmdindex.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cmdindex.h"
+#include "pathhash.h"
+
+/**
+ * @brief The names of the executables in the PATH directories, for completing command names.
+ *
+ * The names are stored back to back in one string pool and the index is a sorted array
+ * of offsets into the pool, so a prefix lookup is a binary search followed by a scan of
+ * the matching names. The index is built on the first completion and only rebuilt when
+ * PATH changes or one of its directories is modified.
+ */
+static struct
+{
+    char *pool;              /**< The names, NUL terminated, back to back. */
+    size_t pool_length;      /**< The number of bytes used in the pool. */
+    size_t pool_capacity;    /**< The size of the pool. */
+    uint32_t *names;         /**< The offsets of the names in the pool, sorted by name. */
+    size_t count;            /**< The number of names. */
+    size_t capacity;         /**< The number of allocated offsets. */
+    char *path;              /**< The PATH value the index was built for, NULL before the first build. */
+    PathDir *dirs;           /**< The PATH directories and their modification times. */
+    int dir_count;           /**< The number of PATH directories. */
+} commands;
+
+/**
+ * Adds a name to the pool and the index.
+ *
+ * @param name The executable name.
+ */
+static void add_name(const char *name)
+{
+    size_t length = strlen(name) + 1;
+
+    if (commands.pool_length + length > commands.pool_capacity)
+    {
+        size_t capacity = commands.pool_capacity ? commands.pool_capacity * 2 : COMMAND_INDEX_POOL_SIZE;
+        while (commands.pool_length + length > capacity)
+        {
+            capacity *= 2;
+        }
+
+        char *pool = realloc(commands.pool, capacity);
+        if (pool == NULL)
+        {
+            perror("Error allocating memory for command index");
+            exit(EXIT_FAILURE);
+        }
+        commands.pool = pool;
+        commands.pool_capacity = capacity;
+    }
+
+    if (commands.count == commands.capacity)
+    {
+        size_t capacity = commands.capacity ? commands.capacity * 2 : COMMAND_INDEX_INITIAL_CAPACITY;
+        uint32_t *names = realloc(commands.names, sizeof(uint32_t) * capacity);
+        if (names == NULL)
+        {
+            perror("Error allocating memory for command index");
+            exit(EXIT_FAILURE);
+        }
+        commands.names = names;
+        commands.capacity = capacity;
+    }
+
+    memcpy(commands.pool + commands.pool_length, name, length);
+    commands.names[commands.count++] = (uint32_t)commands.pool_length;
+    commands.pool_length += length;
+}
+
+/**
+ * Adds the executables of a directory to the index.
+ *
+ * @param dir The PATH directory.
+ */
+static void scan_dir(PathDir *dir)
+{
+    struct stat st;
+
+    DIR *stream = opendir(dir->path);
+    if (stream == NULL)
+    {
+        dir->mtime.tv_sec = 0;
+        dir->mtime.tv_nsec = 0;
+        return;
+    }
+
+    // The modification time is taken before reading, so a change during the scan triggers a rebuild
+    if (fstat(dirfd(stream), &st) == 0)
+    {
+        dir->mtime = st.st_mtim;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(stream)) != NULL)
+    {
+        if (entry->d_name[0] == '.' || entry->d_type == DT_DIR)
+        {
+            continue;
+        }
+
+        // Symbolic links and file systems without d_type need a stat to tell what they are
+        if (fstatat(dirfd(stream), entry->d_name, &st, 0) == 0 && S_ISREG(st.st_mode) && (st.st_mode & 0111))
+        {
+            add_name(entry->d_name);
+        }
+    }
+
+    closedir(stream);
+}
+
+/**
+ * Compares two names of the index for qsort().
+ */
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(commands.pool + *(const uint32_t *)a, commands.pool + *(const uint32_t *)b);
+}
+
+/**
+ * Builds the index for a PATH value.
+ *
+ * @param path The PATH value.
+ */
+static void build_index(const char *path)
+{
+    for (int i = 0; i < commands.dir_count; i++)
+    {
+        free(commands.dirs[i].path);
+    }
+    free(commands.dirs);
+    free(commands.path);
+
+    commands.path = strdup(path);
+    commands.dir_count = 1;
+    for (const char *p = path; *p != '\0'; p++)
+    {
+        commands.dir_count += *p == ':';
+    }
+
+    commands.dirs = calloc(commands.dir_count, sizeof(PathDir));
+    if (commands.path == NULL || commands.dirs == NULL)
+    {
+        perror("Error allocating memory for command index");
+        exit(EXIT_FAILURE);
+    }
+
+    commands.pool_length = 0;
+    commands.count = 0;
+
+    const char *start = path;
+    for (int i = 0; i < commands.dir_count; i++)
+    {
+        const char *end = strchr(start, ':');
+        size_t length = end != NULL ? (size_t)(end - start) : strlen(start);
+
+        commands.dirs[i].path = length > 0 ? strndup(start, length) : strdup(".");
+        start = end != NULL ? end + 1 : start + length;
+
+        scan_dir(&commands.dirs[i]);
+    }
+
+    qsort(commands.names, commands.count, sizeof(uint32_t), compare_names);
+
+    // The same name in several directories is listed once
+    size_t unique = 0;
+    for (size_t i = 0; i < commands.count; i++)
+    {
+        if (unique == 0 || strcmp(commands.pool + commands.names[unique - 1], commands.pool + commands.names[i]) != 0)
+        {
+            commands.names[unique++] = commands.names[i];
+        }
+    }
+    commands.count = unique;
+}
+
+/**
+ * Checks whether the index still matches PATH and its directories.
+ *
+ * @param path The PATH value.
+ * @return true if the index is up to date.
+ */
+static bool index_fresh(const char *path)
+{
+    if (commands.path == NULL || strcmp(commands.path, path) != 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < commands.dir_count; i++)
+    {
+        struct stat st;
+        struct timespec mtime = {0, 0};
+
+        if (stat(commands.dirs[i].path, &st) == 0)
+        {
+            mtime = st.st_mtim;
+        }
+
+        if (mtime.tv_sec != commands.dirs[i].mtime.tv_sec || mtime.tv_nsec != commands.dirs[i].mtime.tv_nsec)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Adds a completion for every executable whose name starts with the word being typed.
+ * Completions replace the whole line, so each one is the line up to the word followed by the name.
+ *
+ * @param line The line being edited, the word runs to its end.
+ * @param word_start The offset of the command word in the line.
+ * @param lc The completion list.
+ */
+void command_index_complete(const char *line, size_t word_start, linenoiseCompletions *lc)
+{
+    const char *path = getenv("PATH");
+    if (path == NULL)
+    {
+        path = PATH_HASH_DEFAULT_PATH;
+    }
+
+    if (!index_fresh(path))
+    {
+        build_index(path);
+    }
+
+    const char *prefix = line + word_start;
+    size_t prefix_length = strlen(prefix);
+
+    // The first name not sorting before the prefix
+    size_t low = 0, high = commands.count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (strncmp(commands.pool + commands.names[middle], prefix, prefix_length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for (size_t i = low; i < commands.count; i++)
+    {
+        const char *name = commands.pool + commands.names[i];
+        if (strncmp(name, prefix, prefix_length) != 0)
+        {
+            break;
+        }
+
+        size_t name_length = strlen(name);
+        char *completion = malloc(word_start + name_length + 2);
+        if (completion == NULL)
+        {
+            perror("Error allocating memory for completion");
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(completion, line, word_start);
+        memcpy(completion + word_start, name, name_length);
+        strcpy(completion + word_start + name_length, " ");
+
+        linenoiseAddCompletion(lc, completion);
+        free(completion);
+    }
+}
+
+/**
+ * Returns the number of executable names in the index.
+ *
+ * @return The number of names, 0 before the first completion.
+ */
+size_t command_index_count(void)
+{
+    return commands.count;
+}
+
+/**
+ * Frees the memory allocated for the command index.
+ */
+void free_command_index(void)
+{
+    for (int i = 0; i < commands.dir_count; i++)
+    {
+        free(commands.dirs[i].path);
+    }
+    free(commands.dirs);
+    free(commands.path);
+    free(commands.pool);
+    free(commands.names);
+    memset(&commands, 0, sizeof(commands));
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         cmdindex.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stddef.h>
+#include "linenoise.h"
+
+// Macros
+#define COMMAND_INDEX_INITIAL_CAPACITY 1024
+#define COMMAND_INDEX_POOL_SIZE (16 * 1024)
+
+// Function Prototypes
+void command_index_complete(const char *line, size_t word_start, linenoiseCompletions *lc);
+size_t command_index_count(void);
+void free_command_index(void);
@@ -0,0 +1,192 @@
+/***************************************************************************/ /**
+   @file         copy.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+#define _GNU_SOURCE
+
+// Library Imports
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include "copy.h"
+
+/**
+ * Checks whether an error means the kernel cannot do a transfer this way for these files,
+ * so the next method should be tried.
+ *
+ * @param err The errno of the failed call.
+ * @return true if another method may succeed.
+ */
+static bool unsupported(int err)
+{
+    return err == EINVAL || err == ENOSYS || err == EOPNOTSUPP || err == EXDEV || err == EBADF || err == ESPIPE;
+}
+
+/**
+ * Copies the rest of a file with a kernel transfer call, without copying through user space.
+ *
+ * @param method 0 for copy_file_range(), 1 for sendfile(), 2 for splice().
+ * @param in_fd The file descriptor to read from.
+ * @param out_fd The file descriptor to write to.
+ * @param total Receives the number of bytes copied.
+ * @return 0 when the input is exhausted, -1 on an error, 1 if the method is not usable for these files.
+ */
+static int kernel_copy(int method, int in_fd, int out_fd, size_t *total)
+{
+    *total = 0;
+
+    for (;;)
+    {
+        ssize_t n;
+
+        switch (method)
+        {
+        case 0:
+            n = copy_file_range(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, 0);
+            break;
+        case 1:
+            n = sendfile(out_fd, in_fd, NULL, COPY_CHUNK_SIZE);
+            break;
+        default:
+            n = splice(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, SPLICE_F_MOVE);
+            break;
+        }
+
+        if (n > 0)
+        {
+            *total += n;
+            continue;
+        }
+
+        if (n == 0)
+        {
+            return 0;
+        }
+
+        if (errno == EINTR)
+        {
+            continue;
+        }
+
+        // Nothing was transferred yet, another method may still work
+        return *total == 0 && unsupported(errno) ? 1 : -1;
+    }
+}
+
+/**
+ * Copies the rest of a file through a user space buffer.
+ *
+ * @param in_fd The file descriptor to read from.
+ * @param out_fd The file descriptor to write to.
+ * @return The number of bytes copied, or -1 on an error.
+ */
+ssize_t copy_fd_rw(int in_fd, int out_fd)
+{
+    static char buffer[COPY_BUFFER_SIZE];
+    size_t total = 0;
+
+    for (;;)
+    {
+        ssize_t n = read(in_fd, buffer, sizeof(buffer));
+        if (n == 0)
+        {
+            return total;
+        }
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        for (ssize_t written = 0; written < n;)
+        {
+            ssize_t w = write(out_fd, buffer + written, n - written);
+            if (w < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return -1;
+            }
+            written += w;
+        }
+
+        total += n;
+    }
+}
+
+/**
+ * Copies everything left in one file descriptor to another, like cat(1) does. The kernel
+ * moves the data when it can: copy_file_range() between files (which may share extents
+ * on reflink file systems), sendfile() from a file to anything, and splice() when either
+ * side is a pipe. Other combinations use a read/write loop.
+ *
+ * Files that report a size of zero (e.g. in /proc) are always read with read(), since
+ * the kernel transfer calls take the size at face value.
+ *
+ * @param in_fd The file descriptor to read from.
+ * @param out_fd The file descriptor to write to.
+ * @return The number of bytes copied, or -1 on an error (errno is set).
+ */
+ssize_t copy_fd(int in_fd, int out_fd)
+{
+    struct stat in_st, out_st;
+    if (fstat(in_fd, &in_st) == -1 || fstat(out_fd, &out_st) == -1)
+    {
+        return -1;
+    }
+
+    bool in_file = S_ISREG(in_st.st_mode) && in_st.st_size > 0;
+    bool in_pipe = S_ISFIFO(in_st.st_mode);
+    bool out_pipe = S_ISFIFO(out_st.st_mode);
+
+    int methods[3];
+    int method_count = 0;
+
+    if (in_file && S_ISREG(out_st.st_mode))
+    {
+        methods[method_count++] = 0;
+    }
+    if (in_file)
+    {
+        methods[method_count++] = 1;
+    }
+    if (in_pipe || out_pipe)
+    {
+        methods[method_count++] = 2;
+    }
+
+    for (int i = 0; i < method_count; i++)
+    {
+        size_t total;
+        int result = kernel_copy(methods[i], in_fd, out_fd, &total);
+
+        if (result == 0)
+        {
+            // A file that shrank to nothing may really be a pseudo file, read it normally
+            if (total == 0 && in_file)
+            {
+                break;
+            }
+            return total;
+        }
+
+        if (result < 0)
+        {
+            return -1;
+        }
+    }
+
+    return copy_fd_rw(in_fd, out_fd);
+}
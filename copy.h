@@ -0,0 +1,19 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         copy.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <sys/types.h>
+
+// Macros
+#define COPY_CHUNK_SIZE (1 << 30)        // Bytes per copy_file_range/sendfile/splice call
+#define COPY_BUFFER_SIZE (128 * 1024)    // Buffer of the read/write fallback
+
+// Function Prototypes
+ssize_t copy_fd(int in_fd, int out_fd);
+ssize_t copy_fd_rw(int in_fd, int out_fd);
@@ -0,0 +1,366 @@
+/***************************************************************************/ /**
+   @file         dircache.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+#define _GNU_SOURCE
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "dircache.h"
+
+/**
+ * @struct listing_t
+ * @brief The names of the entries of one directory, for completing paths.
+ *
+ * The names are stored back to back in one string pool, sorted through an array of
+ * offsets, the way the command index stores them. Directories are stored with a
+ * trailing "/", which no file name can contain.
+ */
+typedef struct
+{
+    dev_t dev;               /**< The device of the directory. */
+    ino_t ino;               /**< The inode of the directory, 0 for an unused slot. */
+    struct timespec mtime;   /**< The modification time of the directory when it was read. */
+    bool stable;             /**< Whether the directory was last modified well before it was read. */
+    unsigned long used;      /**< When the listing was last used, to pick the slot to reuse. */
+    char *pool;              /**< The names, NUL terminated, back to back. */
+    size_t pool_length;      /**< The number of bytes used in the pool. */
+    size_t pool_capacity;    /**< The size of the pool. */
+    uint32_t *names;         /**< The offsets of the names in the pool, sorted by name. */
+    size_t count;            /**< The number of names. */
+    size_t capacity;         /**< The number of allocated offsets. */
+} listing_t;
+
+/**
+ * @brief The cached listings, the least recently used one is replaced when all are taken.
+ */
+static listing_t listings[DIR_CACHE_SLOTS];
+static unsigned long clock_tick = 0;
+
+/**
+ * Adds a name to a listing.
+ *
+ * @param listing The listing.
+ * @param name The entry name.
+ * @param length The length of the name.
+ * @param is_dir Whether the entry is a directory, it is then stored with a trailing "/".
+ */
+static void add_name(listing_t *listing, const char *name, size_t length, bool is_dir)
+{
+    size_t size = length + is_dir + 1;
+
+    if (listing->pool_length + size > listing->pool_capacity)
+    {
+        size_t capacity = listing->pool_capacity ? listing->pool_capacity * 2 : DIR_CACHE_POOL_SIZE;
+        while (listing->pool_length + size > capacity)
+        {
+            capacity *= 2;
+        }
+
+        char *pool = realloc(listing->pool, capacity);
+        if (pool == NULL)
+        {
+            perror("Error allocating memory for directory cache");
+            exit(EXIT_FAILURE);
+        }
+        listing->pool = pool;
+        listing->pool_capacity = capacity;
+    }
+
+    if (listing->count == listing->capacity)
+    {
+        size_t capacity = listing->capacity ? listing->capacity * 2 : DIR_CACHE_INITIAL_CAPACITY;
+        uint32_t *names = realloc(listing->names, sizeof(uint32_t) * capacity);
+        if (names == NULL)
+        {
+            perror("Error allocating memory for directory cache");
+            exit(EXIT_FAILURE);
+        }
+        listing->names = names;
+        listing->capacity = capacity;
+    }
+
+    char *copy = listing->pool + listing->pool_length;
+    memcpy(copy, name, length);
+    if (is_dir)
+    {
+        copy[length] = '/';
+    }
+    copy[length + is_dir] = '\0';
+
+    listing->names[listing->count++] = (uint32_t)listing->pool_length;
+    listing->pool_length += size;
+}
+
+/**
+ * Compares two names of a listing for qsort_r().
+ */
+static int compare_names(const void *a, const void *b, void *pool)
+{
+    return strcmp((char *)pool + *(const uint32_t *)a, (char *)pool + *(const uint32_t *)b);
+}
+
+/**
+ * Reads a directory into a listing with getdents64(), which returns many entries per
+ * system call and, on most file systems, their types, so only symbolic links need a stat.
+ *
+ * @param listing The listing to fill.
+ * @param path The directory.
+ * @return true if the directory could be read.
+ */
+static bool read_listing(listing_t *listing, const char *path)
+{
+    struct stat st;
+    struct timespec now;
+
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, &st) == -1)
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    // A change in the same clock tick as the last one keeps the mtime, so a directory
+    // modified less than a second before it is read is read again on the next lookup
+    clock_gettime(CLOCK_REALTIME, &now);
+    listing->dev = st.st_dev;
+    listing->ino = st.st_ino;
+    listing->mtime = st.st_mtim;
+    listing->stable = now.tv_sec > st.st_mtim.tv_sec + 1;
+    listing->pool_length = 0;
+    listing->count = 0;
+
+    char *buffer = malloc(DIR_CACHE_READ_SIZE);
+    if (buffer == NULL)
+    {
+        perror("Error allocating memory for directory cache");
+        exit(EXIT_FAILURE);
+    }
+
+    ssize_t n;
+    while ((n = getdents64(fd, buffer, DIR_CACHE_READ_SIZE)) > 0)
+    {
+        for (ssize_t offset = 0; offset < n;)
+        {
+            struct dirent64 *entry = (struct dirent64 *)(buffer + offset);
+            offset += entry->d_reclen;
+
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            {
+                continue;
+            }
+
+            bool is_dir = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+            {
+                struct stat target;
+                is_dir = fstatat(fd, name, &target, 0) == 0 && S_ISDIR(target.st_mode);
+            }
+
+            add_name(listing, name, strlen(name), is_dir);
+        }
+    }
+
+    free(buffer);
+    close(fd);
+
+    qsort_r(listing->names, listing->count, sizeof(uint32_t), compare_names, listing->pool);
+    return true;
+}
+
+/**
+ * Returns the listing of a directory, reading it only if it is not cached or has
+ * been modified since it was read.
+ *
+ * @param path The directory.
+ * @return The listing, or NULL if the directory cannot be read.
+ */
+static listing_t *find_listing(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+    {
+        return NULL;
+    }
+
+    listing_t *slot = &listings[0];
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++)
+    {
+        listing_t *listing = &listings[i];
+        if (listing->ino == st.st_ino && listing->dev == st.st_dev)
+        {
+            slot = listing;
+            break;
+        }
+        if (listing->used < slot->used)
+        {
+            slot = listing;
+        }
+    }
+
+    slot->used = ++clock_tick;
+
+    if (slot->ino == st.st_ino && slot->dev == st.st_dev && slot->stable &&
+        slot->mtime.tv_sec == st.st_mtim.tv_sec && slot->mtime.tv_nsec == st.st_mtim.tv_nsec)
+    {
+        return slot;
+    }
+
+    if (!read_listing(slot, path))
+    {
+        slot->ino = 0;
+        return NULL;
+    }
+    return slot;
+}
+
+/**
+ * Resolves the directory part of a word to a path: "~/" is the home directory, and a
+ * relative path is taken from the shell's current directory.
+ *
+ * @param path Receives the directory, PATH_MAX bytes.
+ * @param word The directory part of the word, up to and including its last "/", may be empty.
+ * @param length The length of the directory part.
+ * @param directory The current directory.
+ * @return true if the path fits.
+ */
+static bool resolve_directory(char *path, const char *word, size_t length, const char *directory)
+{
+    int n;
+    const char *home = getenv("HOME");
+
+    if (length >= 2 && word[0] == '~' && word[1] == '/' && home != NULL)
+    {
+        n = snprintf(path, PATH_MAX, "%s%.*s", home, (int)length - 1, word + 1);
+    }
+    else if (length > 0 && word[0] == '/')
+    {
+        n = snprintf(path, PATH_MAX, "%.*s", (int)length, word);
+    }
+    else
+    {
+        n = snprintf(path, PATH_MAX, "%s/%.*s", directory, (int)length, word);
+    }
+
+    return n >= 0 && n < PATH_MAX;
+}
+
+/**
+ * Adds a completion for every entry of a directory whose name starts with the word being
+ * typed. Completions replace the whole line, so each one is the line up to the last "/"
+ * of the word followed by the name, then "/" for a directory or a space for a file.
+ * Hidden entries are only completed when the name being typed starts with ".".
+ *
+ * @param line The line being edited, the word runs to its end.
+ * @param word_start The offset of the word in the line.
+ * @param directory The current directory, relative paths are taken from it.
+ * @param lc The completion list.
+ */
+void dir_cache_complete(const char *line, size_t word_start, const char *directory, linenoiseCompletions *lc)
+{
+    char path[PATH_MAX];
+    const char *word = line + word_start;
+    const char *slash = strrchr(word, '/');
+    const char *prefix = slash != NULL ? slash + 1 : word;
+    size_t dir_length = prefix - word;
+
+    if (!resolve_directory(path, word, dir_length, directory))
+    {
+        return;
+    }
+
+    listing_t *listing = find_listing(path);
+    if (listing == NULL)
+    {
+        return;
+    }
+
+    size_t prefix_length = strlen(prefix);
+    size_t head_length = word_start + dir_length;
+
+    // The first name not sorting before the prefix
+    size_t low = 0, high = listing->count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (strncmp(listing->pool + listing->names[middle], prefix, prefix_length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for (size_t i = low; i < listing->count; i++)
+    {
+        const char *name = listing->pool + listing->names[i];
+        if (strncmp(name, prefix, prefix_length) != 0)
+        {
+            break;
+        }
+        if (name[0] == '.' && prefix[0] != '.')
+        {
+            continue;
+        }
+
+        size_t name_length = strlen(name);
+        char *completion = malloc(head_length + name_length + 2);
+        if (completion == NULL)
+        {
+            perror("Error allocating memory for completion");
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(completion, line, head_length);
+        memcpy(completion + head_length, name, name_length);
+        strcpy(completion + head_length + name_length, name[name_length - 1] == '/' ? "" : " ");
+
+        linenoiseAddCompletion(lc, completion);
+        free(completion);
+    }
+}
+
+/**
+ * Returns the number of entries of a directory, reading it if it is not cached.
+ *
+ * @param directory The directory.
+ * @return The number of entries, 0 if it cannot be read.
+ */
+size_t dir_cache_count(const char *directory)
+{
+    listing_t *listing = find_listing(directory);
+    return listing != NULL ? listing->count : 0;
+}
+
+/**
+ * Frees the memory allocated for the directory cache.
+ */
+void free_dir_cache(void)
+{
+    for (int i = 0; i < DIR_CACHE_SLOTS; i++)
+    {
+        free(listings[i].pool);
+        free(listings[i].names);
+    }
+    memset(listings, 0, sizeof(listings));
+    clock_tick = 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         dircache.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stddef.h>
+#include "linenoise.h"
+
+// Macros
+#define DIR_CACHE_SLOTS 8                 // Directories whose listings are kept
+#define DIR_CACHE_INITIAL_CAPACITY 256    // Names allocated for a new listing
+#define DIR_CACHE_POOL_SIZE (8 * 1024)    // Bytes allocated for the names of a new listing
+#define DIR_CACHE_READ_SIZE (64 * 1024)   // Bytes read per getdents64 call
+
+// Function Prototypes
+void dir_cache_complete(const char *line, size_t word_start, const char *directory, linenoiseCompletions *lc);
+size_t dir_cache_count(const char *directory);
+void free_dir_cache(void);
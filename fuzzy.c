@@ -0,0 +1,750 @@
+/***************************************************************************/ /**
+   @file         fuzzy.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "fuzzy.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief The history lines searched by Ctrl-R.
+ *
+ * The lines are stored back to back, NUL terminated, in one block of text, oldest first.
+ * Every line also has a mask of the characters it contains, so a search first filters
+ * the masks with SIMD compares, several lines per instruction, and only reads the text
+ * of the lines that contain every character of the query. Those are matched with SIMD
+ * byte compares too, and scored. Lines are visited newest first, and the search stops
+ * once the best matches cannot be beaten, or once FUZZY_MAX_SCORED lines were matched,
+ * so a keystroke costs the same on any history: the best matches are those of the
+ * newest lines that contain the query's characters.
+ *
+ * The lines that may still match are kept after a search: the ones that matched, and
+ * the ones it did not get to. When the next query extends the previous one, as it does
+ * while typing, only those are searched.
+ *
+ * Lines dropped from the history are the oldest ones, they are skipped until they make
+ * up half of the lines, then the others are moved down over them.
+ */
+static struct
+{
+    char *text;               /**< The lines, NUL terminated, back to back, then FUZZY_SCAN_PADDING bytes. */
+    size_t length;            /**< The number of bytes used in the text. */
+    size_t capacity;          /**< The size of the text. */
+    uint32_t *starts;         /**< The offset of every line in the text. */
+    uint64_t *masks;          /**< The characters of every line, see char_mask(). */
+    size_t count;             /**< The number of lines, including the dropped ones. */
+    size_t first;             /**< The oldest line still in the history, the lines below it were dropped. */
+    size_t lines_capacity;    /**< The number of allocated offsets and masks. */
+    uint32_t *candidates;     /**< The lines that may match the last query, newest first. */
+    size_t candidate_count;   /**< The number of candidates. */
+    size_t unsearched;        /**< The lines below this index were not searched, they may match too. */
+    size_t searched_count;    /**< The number of lines at the last search. */
+    char query[LINENOISE_SEARCH_MAX]; /**< The last query, empty if the candidates are not valid. */
+} history;
+
+/**
+ * @brief A scored line, for the ranking of the best matches.
+ */
+typedef struct
+{
+    int score;     /**< The score of the match. */
+    uint32_t line; /**< The index of the line. */
+} fuzzy_match_t;
+
+/**
+ * @brief A search in progress.
+ */
+typedef struct
+{
+    const char *query;                      /**< The query. */
+    size_t length;                          /**< The length of the query. */
+    char other[LINENOISE_SEARCH_MAX];       /**< The query's characters in the other case, or the same ones. */
+    uint64_t mask;                          /**< The characters of the query. */
+    int best;                               /**< The highest score a line can get. */
+    fuzzy_match_t top[FUZZY_MAX_RESULTS];   /**< The best matches, best first. */
+    size_t count;                           /**< The number of best matches. */
+    size_t matched;                         /**< The number of lines matched against the query. */
+} search_t;
+
+/**
+ * @brief Collects the lines of a range whose mask has every bit of the query's mask.
+ * It may write up to 3 entries past the lines it returns.
+ */
+typedef size_t (*filter_t)(const uint64_t *masks, size_t from, size_t to, uint64_t query, uint32_t *lines);
+
+/**
+ * @brief Finds where each character of the query is in a line of at most
+ * FUZZY_SHORT_LINE bytes, one bit per byte. It may read up to FUZZY_SCAN_PADDING bytes
+ * past the line.
+ */
+typedef void (*locate_t)(const char *line, size_t length, const search_t *search, uint64_t *positions);
+
+/**
+ * @brief Finds the first byte of a range equal to one of two bytes, a character of the
+ * query in both cases. It may read up to FUZZY_SCAN_PADDING bytes past the range.
+ */
+typedef const char *(*scan_t)(const char *p, const char *end, char a, char b);
+
+/**
+ * @brief The SIMD functions picked for the CPU, and the word separators of the scorer.
+ */
+static filter_t filter = NULL;
+static locate_t locate = NULL;
+static scan_t scan = NULL;
+static bool separators[256];
+
+/**
+ * Returns the mask bit of a character: letters (either case) and digits have a bit
+ * each, other characters share the remaining bits.
+ */
+static inline uint64_t char_mask(unsigned char c)
+{
+    if (c >= 'a' && c <= 'z')
+    {
+        return 1ULL << (c - 'a');
+    }
+    if (c >= 'A' && c <= 'Z')
+    {
+        return 1ULL << (c - 'A');
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return 1ULL << (26 + c - '0');
+    }
+    return 1ULL << (36 + c % 28);
+}
+
+/**
+ * Collects the lines whose mask covers the query, one line at a time. Every line is
+ * written, and only kept if it matches, so there is no branch to mispredict.
+ */
+static size_t filter_scalar(const uint64_t *masks, size_t from, size_t to, uint64_t query, uint32_t *lines)
+{
+    size_t count = 0;
+    for (size_t i = from; i < to; i++)
+    {
+        lines[count] = (uint32_t)i;
+        count += (masks[i] & query) == query;
+    }
+    return count;
+}
+
+#if !defined(__x86_64__)
+/**
+ * Finds where each character of the query is in a short line, one byte at a time.
+ */
+static void locate_scalar(const char *line, size_t length, const search_t *search, uint64_t *positions)
+{
+    for (size_t j = 0; j < search->length; j++)
+    {
+        positions[j] = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            if (line[i] == search->query[j] || line[i] == search->other[j])
+            {
+                positions[j] |= 1ULL << i;
+            }
+        }
+    }
+}
+
+/**
+ * Finds the first byte equal to a or b, one byte at a time.
+ */
+static const char *scan_scalar(const char *p, const char *end, char a, char b)
+{
+    for (; p < end; p++)
+    {
+        if (*p == a || *p == b)
+        {
+            return p;
+        }
+    }
+    return end;
+}
+#else
+/**
+ * Collects the lines whose mask covers the query, two lines at a time. SSE2 has no
+ * 64-bit compare, so both 32-bit halves of a mask are compared.
+ */
+static size_t filter_sse2(const uint64_t *masks, size_t from, size_t to, uint64_t query, uint32_t *lines)
+{
+    __m128i q = _mm_set1_epi64x((long long)query);
+    size_t count = 0, i = from;
+
+    for (; i + 2 <= to; i += 2)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(masks + i));
+        int hits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(v, q), q)));
+        lines[count] = (uint32_t)i;
+        count += (hits & 0x3) == 0x3;
+        lines[count] = (uint32_t)i + 1;
+        count += (hits & 0xc) == 0xc;
+    }
+    return count + filter_scalar(masks, i, to, query, lines + count);
+}
+
+/**
+ * Finds where each character of the query is in a short line, 16 bytes at a time.
+ */
+static void locate_sse2(const char *line, size_t length, const search_t *search, uint64_t *positions)
+{
+    __m128i v[4];
+    uint64_t limit = length < 64 ? (1ULL << length) - 1 : ~0ULL;
+
+    for (int k = 0; k < 4; k++)
+    {
+        v[k] = _mm_loadu_si128((const __m128i *)(line + 16 * k));
+    }
+
+    for (size_t j = 0; j < search->length; j++)
+    {
+        __m128i a = _mm_set1_epi8(search->query[j]), b = _mm_set1_epi8(search->other[j]);
+        uint64_t bits = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            uint64_t hits = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v[k], a), _mm_cmpeq_epi8(v[k], b)));
+            bits |= hits << (16 * k);
+        }
+        positions[j] = bits & limit;
+    }
+}
+
+/**
+ * Finds the first byte equal to a or b, 16 bytes at a time. The last load may go past
+ * the end, into the next line or the padding, and its hits there are dropped.
+ */
+static const char *scan_sse2(const char *p, const char *end, char a, char b)
+{
+    __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+
+    for (; p < end; p += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (end - p < 16)
+        {
+            mask &= (1u << (end - p)) - 1;
+        }
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return end;
+}
+
+/*
+ * The AVX2 versions call no SSE code and do their tails inline: switching between AVX
+ * and SSE code is slow on some CPUs.
+ */
+
+/**
+ * Collects the lines whose mask covers the query, four lines at a time.
+ */
+__attribute__((target("avx2"))) static size_t filter_avx2(const uint64_t *masks, size_t from, size_t to, uint64_t query, uint32_t *lines)
+{
+    __m256i q = _mm256_set1_epi64x((long long)query);
+    size_t count = 0, i = from;
+
+    for (; i + 4 <= to; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(masks + i));
+        int hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(v, q), q)));
+        for (int k = 0; k < 4; k++)
+        {
+            lines[count] = (uint32_t)(i + k);
+            count += (hits >> k) & 1;
+        }
+    }
+    for (; i < to; i++)
+    {
+        lines[count] = (uint32_t)i;
+        count += (masks[i] & query) == query;
+    }
+    return count;
+}
+
+/**
+ * Finds where each character of the query is in a short line, 32 bytes at a time.
+ */
+__attribute__((target("avx2"))) static void locate_avx2(const char *line, size_t length, const search_t *search, uint64_t *positions)
+{
+    __m256i low = _mm256_loadu_si256((const __m256i *)line);
+    __m256i high = _mm256_loadu_si256((const __m256i *)(line + 32));
+    uint64_t limit = length < 64 ? (1ULL << length) - 1 : ~0ULL;
+
+    for (size_t j = 0; j < search->length; j++)
+    {
+        __m256i a = _mm256_set1_epi8(search->query[j]), b = _mm256_set1_epi8(search->other[j]);
+        uint32_t bits_low = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(low, a), _mm256_cmpeq_epi8(low, b)));
+        uint32_t bits_high = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(high, a), _mm256_cmpeq_epi8(high, b)));
+        positions[j] = ((uint64_t)bits_high << 32 | bits_low) & limit;
+    }
+}
+
+/**
+ * Finds the first byte equal to a or b, 32 bytes at a time, like scan_sse2().
+ */
+__attribute__((target("avx2"))) static const char *scan_avx2(const char *p, const char *end, char a, char b)
+{
+    __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+
+    for (; p < end; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (end - p < 32)
+        {
+            mask &= (1u << (end - p)) - 1;
+        }
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return end;
+}
+#endif
+
+/**
+ * Picks the widest SIMD functions the CPU supports and fills the separator table.
+ */
+static void init_search(void)
+{
+#if defined(__x86_64__)
+    bool avx2 = __builtin_cpu_supports("avx2");
+    filter = avx2 ? filter_avx2 : filter_sse2;
+    locate = avx2 ? locate_avx2 : locate_sse2;
+    scan = avx2 ? scan_avx2 : scan_sse2;
+#else
+    filter = filter_scalar;
+    locate = locate_scalar;
+    scan = scan_scalar;
+#endif
+
+    for (int c = 1; c < 256; c++)
+    {
+        separators[c] = strchr(" /-_.=:|;&", c) != NULL;
+    }
+}
+
+/**
+ * Grows an array so it holds more than a given number of elements.
+ *
+ * @param array The array.
+ * @param capacity The number of allocated elements, updated.
+ * @param used The number of elements used.
+ * @param size The size of an element.
+ * @param initial The number of elements of a new array.
+ * @return The array, possibly moved.
+ */
+static void *grow(void *array, size_t *capacity, size_t used, size_t size, size_t initial)
+{
+    if (used < *capacity)
+    {
+        return array;
+    }
+
+    size_t grown = *capacity ? *capacity * 2 : initial;
+    while (grown <= used)
+    {
+        grown *= 2;
+    }
+
+    array = realloc(array, grown * size);
+    if (array == NULL)
+    {
+        perror("Error allocating memory for history search");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = grown;
+    return array;
+}
+
+/**
+ * Adds a line to the lines searched by Ctrl-R.
+ *
+ * @param line The history line.
+ */
+void fuzzy_index_add(const char *line)
+{
+    // Empty lines are kept too, one line per history entry, they never match
+    size_t length = strlen(line) + 1;
+
+    history.text = grow(history.text, &history.capacity, history.length + length + FUZZY_SCAN_PADDING, 1, FUZZY_POOL_SIZE);
+    size_t capacity = history.lines_capacity;
+    history.starts = grow(history.starts, &capacity, history.count, sizeof(uint32_t), FUZZY_INITIAL_CAPACITY);
+    history.masks = grow(history.masks, &history.lines_capacity, history.count, sizeof(uint64_t), FUZZY_INITIAL_CAPACITY);
+
+    uint64_t mask = 0;
+    for (const char *p = line; *p != '\0'; p++)
+    {
+        mask |= char_mask((unsigned char)*p);
+    }
+
+    memcpy(history.text + history.length, line, length);
+    memset(history.text + history.length + length, 0, FUZZY_SCAN_PADDING);
+    history.starts[history.count] = (uint32_t)history.length;
+    history.masks[history.count++] = mask;
+    history.length += length;
+}
+
+/**
+ * Drops the oldest line searched by Ctrl-R, when it is dropped from the history.
+ */
+void fuzzy_index_remove(void)
+{
+    if (history.first == history.count)
+    {
+        return;
+    }
+
+    // The kept candidates may include the line
+    history.first++;
+    history.query[0] = '\0';
+    if (history.first < FUZZY_BLOCK_LINES || history.first < history.count / 2)
+    {
+        return;
+    }
+
+    uint32_t offset = history.starts[history.first];
+    history.count -= history.first;
+    history.length -= offset;
+    memmove(history.text, history.text + offset, history.length + FUZZY_SCAN_PADDING);
+    memmove(history.masks, history.masks + history.first, sizeof(uint64_t) * history.count);
+    for (size_t i = 0; i < history.count; i++)
+    {
+        history.starts[i] = history.starts[i + history.first] - offset;
+    }
+    history.first = 0;
+}
+
+/**
+ * Matches the query in a short line, from the positions of its characters as bits.
+ *
+ * The match is the shortest one ending where a greedy match from the start of the line
+ * ends, so a query is scored on its tightest occurrence near the start.
+ *
+ * @param search The search.
+ * @param line The line.
+ * @param length The length of the line, at most FUZZY_SHORT_LINE.
+ * @param at Receives the offset of every matched character.
+ * @return true if the query is a subsequence of the line.
+ */
+static bool match_short(const search_t *search, const char *line, size_t length, int *at)
+{
+    uint64_t positions[LINENOISE_SEARCH_MAX];
+    locate(line, length, search, positions);
+
+    // The first occurrence of every character after the previous one
+    int p = -1;
+    for (size_t j = 0; j < search->length; j++)
+    {
+        uint64_t after = p < 63 ? positions[j] & (~0ULL << (p + 1)) : 0;
+        if (after == 0)
+        {
+            return false;
+        }
+        p = __builtin_ctzll(after);
+    }
+
+    // Then back from the end, the last occurrence of every character before the next one
+    for (size_t j = search->length - 1; j-- > 0;)
+    {
+        p = 63 - __builtin_clzll(positions[j] & ((1ULL << p) - 1));
+    }
+
+    at[0] = p;
+    for (size_t j = 1; j < search->length; j++)
+    {
+        at[j] = __builtin_ctzll(positions[j] & (~0ULL << (at[j - 1] + 1)));
+    }
+    return true;
+}
+
+/**
+ * Matches the query in a long line like match_short() does, with a byte scan per
+ * character instead of bits.
+ *
+ * @param search The search.
+ * @param line The line.
+ * @param end The end of the line.
+ * @param at Receives the offset of every matched character.
+ * @return true if the query is a subsequence of the line.
+ */
+static bool match_long(const search_t *search, const char *line, const char *end, int *at)
+{
+    const char *query = search->query;
+    const char *p = scan(line, end, query[0], search->other[0]);
+
+    for (size_t j = 1; p != end && j < search->length; j++)
+    {
+        p = scan(p + 1, end, query[j], search->other[j]);
+    }
+    if (p == end)
+    {
+        return false;
+    }
+
+    for (size_t j = search->length - 1; j-- > 0;)
+    {
+        do
+        {
+            p--;
+        } while (*p != query[j] && *p != search->other[j]);
+    }
+
+    at[0] = p - line;
+    for (size_t j = 1; j < search->length; j++)
+    {
+        at[j] = scan(line + at[j - 1] + 1, end, query[j], search->other[j]) - line;
+    }
+    return true;
+}
+
+/**
+ * Scores a match: every matched character scores, characters matched in a row or at
+ * the start of a word score more, and every character skipped in between costs a little.
+ *
+ * @param line The line.
+ * @param at The offset of every matched character.
+ * @param length The length of the query.
+ * @return The score.
+ */
+static int score_match(const char *line, const int *at, size_t length)
+{
+    int score = 0;
+
+    for (size_t j = 0; j < length; j++)
+    {
+        score += FUZZY_SCORE_MATCH;
+        score += at[j] == 0 || separators[(unsigned char)line[at[j] - 1]] ? FUZZY_SCORE_BOUNDARY : 0;
+        if (j > 0)
+        {
+            score += at[j] == at[j - 1] + 1 ? FUZZY_SCORE_CONSECUTIVE : -(at[j] - at[j - 1] - 1) * FUZZY_SCORE_GAP;
+        }
+    }
+
+    return score;
+}
+
+/**
+ * Returns the best score a line can get for a query: every character at the start of a
+ * word, or right after the previous one.
+ *
+ * @param query The query.
+ * @return The highest possible score.
+ */
+static int best_score(const char *query)
+{
+    int score = FUZZY_SCORE_MATCH + FUZZY_SCORE_BOUNDARY;
+
+    for (size_t j = 1; query[j] != '\0'; j++)
+    {
+        int consecutive = FUZZY_SCORE_CONSECUTIVE + (separators[(unsigned char)query[j - 1]] ? FUZZY_SCORE_BOUNDARY : 0);
+        int boundary = FUZZY_SCORE_BOUNDARY - FUZZY_SCORE_GAP;
+        score += FUZZY_SCORE_MATCH + (consecutive > boundary ? consecutive : boundary);
+    }
+
+    return score;
+}
+
+/**
+ * Checks whether the search stops: the best matches cannot be beaten by the lines left
+ * to search, or it matched as many lines as a search may.
+ */
+static inline bool search_done(const search_t *search)
+{
+    return search->matched >= FUZZY_MAX_SCORED ||
+           (search->count == FUZZY_MAX_RESULTS && search->top[FUZZY_MAX_RESULTS - 1].score >= search->best);
+}
+
+/**
+ * Adds a match to the ranking, best first. Lines are ranked newest first, so a line
+ * only enters the ranking with a better score than a newer line, and is dropped if a
+ * newer copy of it is ranked.
+ *
+ * @param search The search.
+ * @param score The score of the line.
+ * @param line The index of the line, older than every ranked one.
+ */
+static void rank(search_t *search, int score, uint32_t line)
+{
+    fuzzy_match_t *top = search->top;
+
+    if (search->count == FUZZY_MAX_RESULTS && score <= top[FUZZY_MAX_RESULTS - 1].score)
+    {
+        return;
+    }
+
+    const char *text = history.text + history.starts[line];
+    size_t position = search->count;
+    for (size_t i = 0; i < search->count; i++)
+    {
+        if (top[i].score == score && strcmp(history.text + history.starts[top[i].line], text) == 0)
+        {
+            return;
+        }
+        if (position == search->count && top[i].score < score)
+        {
+            position = i;
+        }
+    }
+
+    if (search->count < FUZZY_MAX_RESULTS)
+    {
+        search->count++;
+    }
+    memmove(&top[position + 1], &top[position], sizeof(fuzzy_match_t) * (search->count - position - 1));
+    top[position] = (fuzzy_match_t){score, line};
+}
+
+/**
+ * Searches a line whose mask covers the query, and ranks it if it matches.
+ *
+ * @param search The search.
+ * @param line The index of the line.
+ * @return true if the line matches.
+ */
+static bool search_line(search_t *search, uint32_t line)
+{
+    int at[LINENOISE_SEARCH_MAX];
+    const char *start = history.text + history.starts[line];
+    const char *end = history.text + (line + 1 < history.count ? history.starts[line + 1] : history.length) - 1;
+
+    search->matched++;
+    bool matched = end - start <= FUZZY_SHORT_LINE ? match_short(search, start, end - start, at) : match_long(search, start, end, at);
+    if (!matched)
+    {
+        return false;
+    }
+
+    rank(search, score_match(start, at, search->length), line);
+    return true;
+}
+
+/**
+ * Adds the history lines matching a query to a list, best match first. The query
+ * matches a line if its characters appear in the line in order. It is case insensitive
+ * unless it has an upper case character. Of lines with the same score, the newest
+ * comes first.
+ *
+ * @param query The query typed after Ctrl-R.
+ * @param lc The list of matches.
+ */
+void fuzzy_index_search(const char *query, linenoiseCompletions *lc)
+{
+    search_t search = {.query = query, .length = strlen(query)};
+    uint32_t lines[FUZZY_BLOCK_LINES + 4];
+
+    if (filter == NULL)
+    {
+        init_search();
+    }
+
+    if (search.length == 0 || search.length >= sizeof(history.query))
+    {
+        return;
+    }
+
+    bool fold = true;
+    for (size_t j = 0; j < search.length; j++)
+    {
+        fold = fold && !(query[j] >= 'A' && query[j] <= 'Z');
+        search.mask |= char_mask((unsigned char)query[j]);
+    }
+    for (size_t j = 0; j < search.length; j++)
+    {
+        bool letter = query[j] >= 'a' && query[j] <= 'z';
+        search.other[j] = fold && letter ? query[j] - ('a' - 'A') : query[j];
+    }
+    search.best = best_score(query);
+
+    // A longer query only matches lines that may match a query it starts with
+    size_t last_length = strlen(history.query);
+    if (last_length == 0 || history.searched_count != history.count || strncmp(query, history.query, last_length) != 0)
+    {
+        history.candidates = realloc(history.candidates, sizeof(uint32_t) * (history.count + 1));
+        if (history.candidates == NULL)
+        {
+            perror("Error allocating memory for history search");
+            exit(EXIT_FAILURE);
+        }
+        history.candidate_count = 0;
+        history.unsearched = history.count;
+    }
+
+    // The candidates first, they are newer than the unsearched lines
+    size_t kept = 0, next = 0;
+    while (next < history.candidate_count && !search_done(&search))
+    {
+        uint32_t line = history.candidates[next++];
+        if ((history.masks[line] & search.mask) == search.mask && search_line(&search, line))
+        {
+            history.candidates[kept++] = line;
+        }
+    }
+    memmove(history.candidates + kept, history.candidates + next, sizeof(uint32_t) * (history.candidate_count - next));
+    kept += history.candidate_count - next;
+
+    // Then blocks of unsearched lines, newest first. A search that stops inside a block
+    // leaves the lines below the last one it matched unsearched.
+    while (history.unsearched > history.first && !search_done(&search))
+    {
+        size_t from = history.unsearched > history.first + FUZZY_BLOCK_LINES ? history.unsearched - FUZZY_BLOCK_LINES : history.first;
+        size_t found = filter(history.masks, from, history.unsearched, search.mask, lines);
+
+        while (found > 0 && !search_done(&search))
+        {
+            uint32_t line = lines[--found];
+            if (search_line(&search, line))
+            {
+                history.candidates[kept++] = line;
+            }
+        }
+        history.unsearched = found > 0 ? lines[found - 1] + 1 : from;
+    }
+
+    history.candidate_count = kept;
+    history.searched_count = history.count;
+    memcpy(history.query, query, search.length + 1);
+
+    for (size_t i = 0; i < search.count; i++)
+    {
+        linenoiseAddCompletion(lc, history.text + history.starts[search.top[i].line]);
+    }
+}
+
+/**
+ * Returns the number of lines searched by Ctrl-R.
+ *
+ * @return The number of lines.
+ */
+size_t fuzzy_index_count(void)
+{
+    return history.count - history.first;
+}
+
+/**
+ * Frees the memory allocated for the history search.
+ */
+void free_fuzzy_index(void)
+{
+    free(history.text);
+    free(history.starts);
+    free(history.masks);
+    free(history.candidates);
+    memset(&history, 0, sizeof(history));
+}
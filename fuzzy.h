@@ -0,0 +1,32 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         fuzzy.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stddef.h>
+#include "linenoise.h"
+
+// Macros
+#define FUZZY_MAX_RESULTS 16           // Matches shown by a Ctrl-R search
+#define FUZZY_POOL_SIZE (64 * 1024)    // Bytes allocated for the first history lines
+#define FUZZY_INITIAL_CAPACITY 1024    // Lines allocated for the first history lines
+#define FUZZY_BLOCK_LINES 1024         // Lines filtered at a time, newest block first
+#define FUZZY_MAX_SCORED 512           // Lines matched per search at most, newest first
+#define FUZZY_SHORT_LINE 64            // Longest line matched with one bit per byte
+#define FUZZY_SCAN_PADDING 64          // Bytes after the text, so a SIMD load may go past the last line
+#define FUZZY_SCORE_MATCH 16           // Score of every matched character
+#define FUZZY_SCORE_CONSECUTIVE 8      // Bonus for a character matched right after the previous one
+#define FUZZY_SCORE_BOUNDARY 8         // Bonus for a character matched at the start of a word
+#define FUZZY_SCORE_GAP 1              // Penalty for every skipped character inside the match
+
+// Function Prototypes
+void fuzzy_index_add(const char *line);
+void fuzzy_index_remove(void);
+void fuzzy_index_search(const char *query, linenoiseCompletions *lc);
+size_t fuzzy_index_count(void);
+void free_fuzzy_index(void);
@@ -0,0 +1,298 @@
+/***************************************************************************/ /**
+   @file         git.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "git.h"
+
+/**
+ * @brief Cached result of the last branch lookup.
+ *
+ * The cache is keyed on the directory the lookup was made from and on the identity
+ * of the HEAD file (device, inode, size and mtime). Git rewrites HEAD through a
+ * lock file and a rename, so any branch switch changes at least one of these.
+ *
+ * A directory outside any repository is remembered too, with the mtime of the
+ * directory, so its parents are not searched again for every prompt. Creating a
+ * ".git" in the directory itself, e.g. "git init", changes its mtime.
+ */
+static struct
+{
+    bool valid;
+    bool no_repo;   /**< The directory is not inside a repository, HEAD is unused. */
+    char directory[PATH_MAX];
+    char head_path[PATH_MAX + 8];
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    char branch[GIT_BRANCH_SIZE];
+} cache;
+
+/**
+ * Removes the trailing newline (and carriage return) from a line.
+ *
+ * @param line The line to be trimmed in place.
+ */
+static void trim_newline(char *line)
+{
+    line[strcspn(line, "\r\n")] = '\0';
+}
+
+/**
+ * Resolves the git directory referenced by a ".git" file, as used by worktrees and submodules.
+ * The file contains a single "gitdir: <path>" line, where the path may be relative to the
+ * directory containing the file.
+ *
+ * @param file The path of the ".git" file.
+ * @param base The directory containing the ".git" file.
+ * @param git_dir The buffer to store the resolved git directory.
+ * @param size The size of the git_dir buffer.
+ * @return 0 on success, -1 if the file could not be read or is malformed.
+ */
+static int read_gitdir_file(const char *file, const char *base, char *git_dir, size_t size)
+{
+    FILE *fp = fopen(file, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    char line[PATH_MAX];
+    char *result = fgets(line, sizeof(line), fp);
+    fclose(fp);
+
+    if (result == NULL || strncmp(line, "gitdir: ", 8) != 0)
+    {
+        return -1;
+    }
+
+    trim_newline(line);
+    char *value = line + 8;
+
+    if (value[0] == '/')
+    {
+        snprintf(git_dir, size, "%s", value);
+    }
+    else
+    {
+        snprintf(git_dir, size, "%s/%s", base, value);
+    }
+
+    return 0;
+}
+
+/**
+ * Walks up from a directory looking for a ".git" directory or ".git" file.
+ *
+ * @param directory The directory to start searching from.
+ * @param git_dir The buffer to store the git directory that was found.
+ * @param size The size of the git_dir buffer.
+ * @return 0 if a git directory was found, -1 otherwise.
+ */
+static int find_git_dir(const char *directory, char *git_dir, size_t size)
+{
+    char path[PATH_MAX];
+    char candidate[PATH_MAX + 8];
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s", directory);
+
+    while (path[0] != '\0')
+    {
+        snprintf(candidate, sizeof(candidate), "%s/.git", strcmp(path, "/") == 0 ? "" : path);
+
+        if (stat(candidate, &st) == 0)
+        {
+            if (S_ISDIR(st.st_mode))
+            {
+                snprintf(git_dir, size, "%s", candidate);
+                return 0;
+            }
+
+            if (S_ISREG(st.st_mode))
+            {
+                return read_gitdir_file(candidate, path, git_dir, size);
+            }
+        }
+
+        char *slash = strrchr(path, '/');
+        if (slash == NULL || strcmp(path, "/") == 0)
+        {
+            break;
+        }
+
+        if (slash == path)
+        {
+            path[1] = '\0'; // keep the root directory
+        }
+        else
+        {
+            *slash = '\0';
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Reads the HEAD file and extracts the branch name the same way
+ * "git rev-parse --abbrev-ref HEAD" prints it. A detached HEAD yields "HEAD".
+ *
+ * @param head_path The path of the HEAD file.
+ * @param branch The buffer to store the branch name.
+ * @param size The size of the branch buffer.
+ * @return 0 on success, -1 if the HEAD file could not be read.
+ */
+static int read_head(const char *head_path, char *branch, size_t size)
+{
+    FILE *fp = fopen(head_path, "r");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    char line[GIT_BRANCH_SIZE];
+    char *result = fgets(line, sizeof(line), fp);
+    fclose(fp);
+
+    if (result == NULL)
+    {
+        return -1;
+    }
+
+    trim_newline(line);
+
+    if (strncmp(line, "ref: ", 5) == 0)
+    {
+        char *ref = line + 5;
+
+        if (strncmp(ref, "refs/heads/", 11) == 0)
+        {
+            ref += 11;
+        }
+        else if (strncmp(ref, "refs/", 5) == 0)
+        {
+            ref += 5;
+        }
+
+        snprintf(branch, size, "%s", ref);
+    }
+    else
+    {
+        snprintf(branch, size, "HEAD");
+    }
+
+    return 0;
+}
+
+/**
+ * Remembers the identity of the cached HEAD file, or of the directory outside a repository.
+ *
+ * @param st The stat information of the file.
+ */
+static void remember_stat(const struct stat *st)
+{
+    cache.dev = st->st_dev;
+    cache.ino = st->st_ino;
+    cache.size = st->st_size;
+    cache.mtime = st->st_mtim;
+}
+
+/**
+ * Returns true if the stat information still matches the cached HEAD file, or the
+ * cached directory outside a repository.
+ *
+ * @param st The stat information of the file.
+ */
+static bool cache_matches(const struct stat *st)
+{
+    return cache.dev == st->st_dev && cache.ino == st->st_ino && cache.size == st->st_size &&
+           cache.mtime.tv_sec == st->st_mtim.tv_sec && cache.mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief Returns the current git branch for a directory without spawning git.
+ *
+ * The lookup walks up from the directory to find the repository, then reads HEAD directly.
+ * When called again from the same directory, only a single stat() of HEAD is needed
+ * to validate the cached branch name, or of the directory when it is outside a repository.
+ *
+ * @param directory The directory to resolve the branch for.
+ * @return The branch name, or an empty string if the directory is not inside a git repository.
+ *         The returned string is owned by this module and is valid until the next call.
+ */
+const char *git_branch(const char *directory)
+{
+    struct stat st;
+
+    if (directory == NULL)
+    {
+        return "";
+    }
+
+    bool same_directory = cache.valid && strcmp(cache.directory, directory) == 0;
+
+    if (same_directory && cache.no_repo)
+    {
+        if (stat(directory, &st) == 0 && cache_matches(&st))
+        {
+            return "";
+        }
+        same_directory = false;
+    }
+
+    if (same_directory && stat(cache.head_path, &st) == 0)
+    {
+        if (cache_matches(&st))
+        {
+            return cache.branch;
+        }
+    }
+    else
+    {
+        char git_dir[PATH_MAX];
+
+        cache.valid = false;
+        if (find_git_dir(directory, git_dir, sizeof(git_dir)) != 0)
+        {
+            // Remember the miss until the directory changes
+            if (stat(directory, &st) == 0)
+            {
+                snprintf(cache.directory, sizeof(cache.directory), "%s", directory);
+                remember_stat(&st);
+                cache.no_repo = true;
+                cache.valid = true;
+            }
+            return "";
+        }
+
+        snprintf(cache.head_path, sizeof(cache.head_path), "%s/HEAD", git_dir);
+        if (stat(cache.head_path, &st) != 0)
+        {
+            return "";
+        }
+    }
+
+    if (read_head(cache.head_path, cache.branch, sizeof(cache.branch)) != 0)
+    {
+        cache.valid = false;
+        return "";
+    }
+
+    snprintf(cache.directory, sizeof(cache.directory), "%s", directory);
+    remember_stat(&st);
+    cache.no_repo = false;
+    cache.valid = true;
+
+    return cache.branch;
+}
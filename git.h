@@ -0,0 +1,14 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         git.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Macros
+#define GIT_BRANCH_SIZE 1024
+
+// Function Prototypes
+const char *git_branch(const char *directory);
@@ -0,0 +1,644 @@
+/***************************************************************************/ /**
+   @file         histfile.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "histfile.h"
+#include "linenoise.h"
+
+/**
+ * @brief Called for every entry of the history, oldest first.
+ */
+typedef void (*record_fn)(const HistoryFileEntry *entry, const char *strings, void *arg);
+
+/**
+ * @brief The binary history: the file mapped at startup, and the entries added since.
+ *
+ * Every line run is appended to the file as a record with one write, like the text
+ * history. Once HISTORY_FILE_COMPACT_RECORDS records were appended, by this shell or by
+ * earlier ones, the file is rewritten with every entry in its table, and mapped again.
+ * The entries added since the last mapping are kept in memory until then. The mapping
+ * linenoise loaded its lines from is never unmapped, since it holds pointers into it.
+ */
+static struct
+{
+    char *path;               /**< The binary history file, NULL if it is not used. */
+    int max_length;           /**< The number of entries kept in the file. */
+    pid_t pid;                /**< The shell, children never write the file. */
+    const char *map;          /**< The mapped file, or NULL. */
+    size_t map_length;        /**< The length of the mapping. */
+    const char *lines_map;    /**< The mapping linenoise holds lines of, or NULL. */
+    char **added;             /**< The records added since the file was mapped, each an entry and its strings. */
+    size_t added_count;       /**< The number of added records. */
+    size_t added_capacity;    /**< The number of allocated record pointers. */
+    size_t appended;          /**< The number of records appended to the file since it was written. */
+    char *pending;            /**< The record of the line being run, written once it finishes. */
+    struct timespec started;  /**< When the line being run was read. */
+} history_file;
+
+/**
+ * Rounds a length up to the 8 byte alignment of the entries.
+ *
+ * @param length The length.
+ * @return The padded length.
+ */
+static size_t pad8(size_t length)
+{
+    return (length + 7) & ~(size_t)7;
+}
+
+/**
+ * Checks that the strings of an entry are within its strings and NUL terminated.
+ *
+ * @param entry The entry.
+ * @param strings_length The length of its strings, whose last byte is NUL.
+ * @return true if the entry is valid.
+ */
+static bool valid_entry(const HistoryFileEntry *entry, uint64_t strings_length)
+{
+    return entry->line < strings_length && entry->cwd < strings_length;
+}
+
+/**
+ * Calls a function for every record appended to the mapped file since it was written.
+ * A truncated last record is skipped.
+ *
+ * @param fn The function, may be NULL to only count the records.
+ * @param arg Passed to the function.
+ * @return The number of records.
+ */
+static size_t walk_appended(record_fn fn, void *arg)
+{
+    size_t count = 0;
+
+    if (history_file.map == NULL)
+    {
+        return 0;
+    }
+
+    const HistoryFileHeader *header = (const HistoryFileHeader *)history_file.map;
+    size_t offset = sizeof(HistoryFileHeader) + (size_t)header->count * sizeof(HistoryFileEntry) + header->strings_length;
+    while (offset + sizeof(HistoryFileEntry) <= history_file.map_length)
+    {
+        const HistoryFileEntry *entry = (const HistoryFileEntry *)(history_file.map + offset);
+        const char *record_strings = (const char *)(entry + 1);
+        size_t length = entry->strings_length;
+
+        // A record cut short by a crash ends the file
+        if (length == 0 || length > history_file.map_length - offset - sizeof(HistoryFileEntry) ||
+            record_strings[length - 1] != '\0' || !valid_entry(entry, length))
+        {
+            break;
+        }
+
+        if (fn != NULL)
+        {
+            fn(entry, record_strings, arg);
+        }
+        count++;
+        offset += sizeof(HistoryFileEntry) + length;
+    }
+
+    return count;
+}
+
+/**
+ * Calls a function for every entry of the history: the table of the mapped file, the
+ * records appended to it, then the records added since it was mapped. The mapped file
+ * was checked when it was opened, invalid entries are skipped.
+ *
+ * @param fn The function, may be NULL to only count the entries.
+ * @param arg Passed to the function.
+ * @return The number of entries.
+ */
+static size_t walk_records(record_fn fn, void *arg)
+{
+    size_t count = 0;
+
+    if (history_file.map != NULL)
+    {
+        const HistoryFileHeader *header = (const HistoryFileHeader *)history_file.map;
+        const HistoryFileEntry *table = (const HistoryFileEntry *)(history_file.map + sizeof(HistoryFileHeader));
+        const char *strings = (const char *)(table + header->count);
+
+        for (uint32_t i = 0; i < header->count; i++)
+        {
+            if (valid_entry(&table[i], header->strings_length))
+            {
+                if (fn != NULL)
+                {
+                    fn(&table[i], strings, arg);
+                }
+                count++;
+            }
+        }
+    }
+
+    count += walk_appended(fn, arg);
+
+    for (size_t i = 0; i < history_file.added_count; i++)
+    {
+        if (fn != NULL)
+        {
+            fn((const HistoryFileEntry *)history_file.added[i], history_file.added[i] + sizeof(HistoryFileEntry), arg);
+        }
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Maps the binary history file and checks its header.
+ *
+ * @return 0 if the file is mapped, 1 if it does not exist, -1 if it is not a history file.
+ */
+static int map_file(void)
+{
+    int fd = open(history_file.path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return access(history_file.path, F_OK) == -1 ? 1 : -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(HistoryFileHeader))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const HistoryFileHeader *header = data;
+    size_t table_end = sizeof(HistoryFileHeader) + (size_t)header->count * sizeof(HistoryFileEntry);
+    const char *strings = (const char *)data + table_end;
+
+    bool valid = header->magic == HISTORY_FILE_MAGIC &&
+                 header->version == HISTORY_FILE_VERSION &&
+                 table_end <= (size_t)st.st_size &&
+                 header->strings_length <= (size_t)st.st_size - table_end &&
+                 (header->strings_length == 0 ? header->count == 0 : strings[header->strings_length - 1] == '\0');
+
+    if (!valid)
+    {
+        munmap(data, st.st_size);
+        return -1;
+    }
+
+    history_file.map = data;
+    history_file.map_length = st.st_size;
+    return 0;
+}
+
+/**
+ * Builds a record: an entry followed by its line and directory.
+ *
+ * @param line The line.
+ * @param cwd The directory it ran in.
+ * @param time When it was run, 0 if unknown.
+ * @param duration_us How long it ran, -1 if unknown.
+ * @param status Its exit status, -1 if unknown.
+ * @return The record, heap allocated, or NULL if out of memory.
+ */
+static char *new_record(const char *line, const char *cwd, int64_t time, int64_t duration_us, int32_t status)
+{
+    size_t line_length = strlen(line) + 1;
+    size_t cwd_length = strlen(cwd) + 1;
+    size_t strings_length = pad8(line_length + cwd_length);
+
+    char *record = calloc(1, sizeof(HistoryFileEntry) + strings_length);
+    if (record == NULL)
+    {
+        return NULL;
+    }
+
+    HistoryFileEntry *entry = (HistoryFileEntry *)record;
+    entry->time = time;
+    entry->duration_us = duration_us;
+    entry->line = 0;
+    entry->cwd = line_length;
+    entry->status = status;
+    entry->strings_length = strings_length;
+
+    memcpy(record + sizeof(HistoryFileEntry), line, line_length);
+    memcpy(record + sizeof(HistoryFileEntry) + line_length, cwd, cwd_length);
+    return record;
+}
+
+/**
+ * Frees the oldest records added since the file was mapped.
+ *
+ * @param count The number of records to free.
+ */
+static void drop_records(size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        free(history_file.added[i]);
+    }
+    history_file.added_count -= count;
+    memmove(history_file.added, history_file.added + count, sizeof(char *) * history_file.added_count);
+}
+
+/**
+ * Keeps a record added since the file was mapped. Only the newest max_length entries
+ * are ever written, so when the file cannot be rewritten, older records are dropped
+ * once twice as many were added.
+ *
+ * @param record The record, owned by the history from now on.
+ */
+static void add_record(char *record)
+{
+    size_t max_length = history_file.max_length > 0 ? history_file.max_length : 1;
+    if (history_file.added_count >= 2 * max_length)
+    {
+        drop_records(history_file.added_count - max_length);
+    }
+
+    if (history_file.added_count == history_file.added_capacity)
+    {
+        size_t capacity = history_file.added_capacity ? history_file.added_capacity * 2 : 64;
+        char **added = realloc(history_file.added, sizeof(char *) * capacity);
+        if (added == NULL)
+        {
+            free(record);
+            return;
+        }
+        history_file.added = added;
+        history_file.added_capacity = capacity;
+    }
+
+    history_file.added[history_file.added_count++] = record;
+}
+
+/**
+ * Maps the file again once it was rewritten, so the records added since the last
+ * mapping, which it now holds, are freed.
+ */
+static void remap_file(void)
+{
+    const char *old_map = history_file.map;
+    size_t old_length = history_file.map_length;
+
+    if (map_file() != 0)
+    {
+        return;
+    }
+
+    if (old_map != NULL && old_map != history_file.lines_map)
+    {
+        munmap((void *)old_map, old_length);
+    }
+    drop_records(history_file.added_count);
+}
+
+/**
+ * @brief The entries collected for rewriting the file.
+ */
+typedef struct
+{
+    const HistoryFileEntry **entries; /**< The entries. */
+    const char **strings;             /**< The strings of every entry. */
+    size_t count;                     /**< The number of entries collected. */
+} collected_t;
+
+/**
+ * Collects an entry, for walk_records().
+ */
+static void collect_record(const HistoryFileEntry *entry, const char *strings, void *arg)
+{
+    collected_t *collected = arg;
+    collected->entries[collected->count] = entry;
+    collected->strings[collected->count++] = strings;
+}
+
+/**
+ * Rewrites the binary history file with the newest entries in its table. The file is
+ * written under a temporary name and renamed over the old one once it is complete,
+ * then mapped in place of the old one.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int write_file(void)
+{
+    size_t total = walk_records(NULL, NULL);
+    collected_t collected = {malloc(sizeof(HistoryFileEntry *) * (total + 1)), malloc(sizeof(char *) * (total + 1)), 0};
+    char *tmp_path = malloc(strlen(history_file.path) + 32);
+    FILE *fp = NULL;
+    int result = -1;
+
+    if (collected.entries == NULL || collected.strings == NULL || tmp_path == NULL)
+    {
+        goto done;
+    }
+    walk_records(collect_record, &collected);
+
+    size_t first = total > (size_t)history_file.max_length ? total - history_file.max_length : 0;
+    HistoryFileHeader header = {HISTORY_FILE_MAGIC, HISTORY_FILE_VERSION, (uint32_t)(total - first), 0, 0};
+    for (size_t i = first; i < total; i++)
+    {
+        header.strings_length += strlen(collected.strings[i] + collected.entries[i]->line) + 1;
+        header.strings_length += strlen(collected.strings[i] + collected.entries[i]->cwd) + 1;
+    }
+    header.strings_length = pad8(header.strings_length);
+    if (header.strings_length > UINT32_MAX)
+    {
+        goto done;
+    }
+
+    // A private temporary name, so concurrent shells never read a half written file
+    sprintf(tmp_path, "%s.%ld.tmp", history_file.path, (long)getpid());
+    mode_t old_umask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    fp = fopen(tmp_path, "wb");
+    umask(old_umask);
+    if (fp == NULL)
+    {
+        goto done;
+    }
+
+    fwrite(&header, sizeof(header), 1, fp);
+
+    uint32_t offset = 0;
+    for (size_t i = first; i < total; i++)
+    {
+        HistoryFileEntry entry = *collected.entries[i];
+        entry.line = offset;
+        offset += strlen(collected.strings[i] + collected.entries[i]->line) + 1;
+        entry.cwd = offset;
+        offset += strlen(collected.strings[i] + collected.entries[i]->cwd) + 1;
+        entry.strings_length = 0;
+        fwrite(&entry, sizeof(entry), 1, fp);
+    }
+
+    for (size_t i = first; i < total; i++)
+    {
+        const char *line = collected.strings[i] + collected.entries[i]->line;
+        const char *cwd = collected.strings[i] + collected.entries[i]->cwd;
+        fwrite(line, 1, strlen(line) + 1, fp);
+        fwrite(cwd, 1, strlen(cwd) + 1, fp);
+    }
+
+    static const char padding[8] = {0};
+    fwrite(padding, 1, header.strings_length - offset, fp);
+
+    if (fflush(fp) == 0 && !ferror(fp) && fsync(fileno(fp)) == 0 && rename(tmp_path, history_file.path) == 0)
+    {
+        history_file.appended = 0;
+        result = 0;
+    }
+
+done:
+    if (fp != NULL)
+    {
+        fclose(fp);
+        if (result != 0)
+        {
+            unlink(tmp_path);
+        }
+    }
+    free(tmp_path);
+    free(collected.entries);
+    free(collected.strings);
+
+    if (result == 0)
+    {
+        remap_file();
+    }
+    return result;
+}
+
+/**
+ * Appends a record to the binary history file with one write(), so the records of
+ * shells sharing the file never interleave.
+ *
+ * @param record The record.
+ */
+static void append_record(const char *record)
+{
+    const HistoryFileEntry *entry = (const HistoryFileEntry *)record;
+    size_t length = sizeof(HistoryFileEntry) + entry->strings_length;
+
+    int fd = open(history_file.path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    ssize_t written = write(fd, record, length);
+    close(fd);
+
+    if (written == (ssize_t)length && ++history_file.appended >= HISTORY_FILE_COMPACT_RECORDS)
+    {
+        write_file();
+    }
+}
+
+/**
+ * Adds the line of an entry to linenoise, for walk_records().
+ */
+static void add_line(const HistoryFileEntry *entry, const char *strings, void *arg)
+{
+    linenoiseHistoryAdd(strings + entry->line);
+}
+
+/**
+ * Writes the line being run when the shell exits in the middle of it, e.g. on "exit".
+ */
+static void finish_at_exit(void)
+{
+    history_file_finish(-1);
+}
+
+/**
+ * Loads the history from the binary history file next to a text history file. The file
+ * is mapped and its lines are added to linenoise in place. If there is no binary history
+ * yet, it is created from the text history.
+ *
+ * @param filename The text history file, the binary one has HISTORY_FILE_SUFFIX appended.
+ * @param max_length The number of entries kept.
+ * @return 0 on success, -1 on error, 1 if the binary history cannot be used and the
+ *         text history was loaded instead.
+ */
+int history_file_load(const char *filename, int max_length)
+{
+    size_t length = strlen(filename) + sizeof(HISTORY_FILE_SUFFIX);
+    history_file.path = malloc(length);
+    if (history_file.path == NULL)
+    {
+        linenoiseHistoryLoad(filename);
+        return 1;
+    }
+    snprintf(history_file.path, length, "%s%s", filename, HISTORY_FILE_SUFFIX);
+    history_file.max_length = max_length;
+    history_file.pid = getpid();
+    atexit(finish_at_exit);
+
+    int mapped = map_file();
+    if (mapped == 1)
+    {
+        // No binary history yet, import the text one
+        linenoiseHistoryLoad(filename);
+        for (int i = 0; i < linenoiseHistoryLength(); i++)
+        {
+            char *record = new_record(linenoiseHistoryGet(i), "", 0, -1, -1);
+            if (record != NULL)
+            {
+                add_record(record);
+            }
+        }
+        return write_file();
+    }
+
+    if (mapped == -1)
+    {
+        fprintf(stderr, "dsh: %s is not a history file, using %s\n", history_file.path, filename);
+        free(history_file.path);
+        history_file.path = NULL;
+        linenoiseHistoryLoad(filename);
+        return 1;
+    }
+
+    // Records appended by earlier sessions count towards the next rewrite, and a file
+    // holding more of them than entries kept is rewritten before its lines are loaded
+    history_file.appended = walk_appended(NULL, NULL);
+    if (history_file.appended > (size_t)max_length)
+    {
+        write_file();
+    }
+
+    history_file.lines_map = history_file.map;
+    linenoiseHistorySetStatic(history_file.map, history_file.map_length);
+    walk_records(add_line, NULL);
+    return 0;
+}
+
+/**
+ * Starts recording a line that is about to run. It is written to the binary history
+ * once it finishes, with its exit status and duration.
+ *
+ * @param line The line.
+ * @param cwd The directory it runs in.
+ */
+void history_file_begin(const char *line, const char *cwd)
+{
+    if (history_file.path == NULL)
+    {
+        return;
+    }
+
+    free(history_file.pending);
+    history_file.pending = new_record(line, cwd != NULL ? cwd : "", time(NULL), -1, -1);
+    clock_gettime(CLOCK_MONOTONIC, &history_file.started);
+}
+
+/**
+ * Writes the line started with history_file_begin() to the binary history.
+ *
+ * @param status The exit status of the line.
+ */
+void history_file_finish(int status)
+{
+    if (history_file.pending == NULL || getpid() != history_file.pid)
+    {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    HistoryFileEntry *entry = (HistoryFileEntry *)history_file.pending;
+    entry->duration_us = (now.tv_sec - history_file.started.tv_sec) * 1000000LL + (now.tv_nsec - history_file.started.tv_nsec) / 1000;
+    entry->status = status;
+
+    char *record = history_file.pending;
+    history_file.pending = NULL;
+    add_record(record);
+    append_record(record);
+}
+
+/**
+ * Writes an entry as a line of text, for walk_records().
+ */
+static void export_line(const HistoryFileEntry *entry, const char *strings, void *arg)
+{
+    fprintf(arg, "%s\n", strings + entry->line);
+}
+
+/**
+ * Exports the binary history as a text history file, one line per entry, which can be
+ * searched with grep or loaded with HISTORY_FORMAT = text.
+ *
+ * @param filename The text file to write.
+ * @return 0 on success, -1 on error.
+ */
+int history_file_export(const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL)
+    {
+        return -1;
+    }
+
+    walk_records(export_line, fp);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * Prints an entry with how it ran, for walk_records().
+ */
+static void list_entry(const HistoryFileEntry *entry, const char *strings, void *arg)
+{
+    char when[32] = "-", status[16] = "-", duration[32] = "-";
+    time_t seconds = (time_t)entry->time;
+    struct tm tm;
+
+    if (entry->time != 0 && localtime_r(&seconds, &tm) != NULL)
+    {
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+    }
+    if (entry->status != -1)
+    {
+        snprintf(status, sizeof(status), "%d", entry->status);
+    }
+    if (entry->duration_us != -1)
+    {
+        snprintf(duration, sizeof(duration), "%.3fs", entry->duration_us / 1e6);
+    }
+
+    const char *cwd = strings[entry->cwd] != '\0' ? strings + entry->cwd : "-";
+    fprintf(arg, "%s\t%s\t%s\t%s\t%s\n", when, status, duration, cwd, strings + entry->line);
+}
+
+/**
+ * Prints every entry of the binary history with its time, exit status, duration and
+ * directory, separated by tabs. Unknown fields are printed as "-".
+ *
+ * @param out The stream to print to.
+ */
+void history_file_list(FILE *out)
+{
+    walk_records(list_entry, out);
+}
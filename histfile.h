@@ -0,0 +1,62 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         histfile.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdint.h>
+
+// Macros
+#define HISTORY_FILE_MAGIC 0x48485344 // "DSHH"
+#define HISTORY_FILE_VERSION 1
+#define HISTORY_FILE_SUFFIX ".bin"          // Appended to the history file name for the binary history
+#define HISTORY_FILE_COMPACT_RECORDS 1024   // Appended records at which the file is rewritten
+
+/**
+ * @struct HistoryFileHeader
+ * @brief The header of a binary history file.
+ *
+ * The header is followed by the entry table, then by the strings of the entries, then
+ * by the records appended since the file was written:
+ *
+ *   table:   count * entry, oldest first
+ *   strings: strings_length bytes of NUL terminated lines and directories
+ *   record:  entry, strings_length bytes of its own line and directory
+ *
+ * Lengths are padded to 8 bytes. The file is mapped and its lines are handed to linenoise
+ * in place, so loading it does not allocate or copy an entry.
+ */
+typedef struct HistoryFileHeader
+{
+  uint32_t magic;          /**< HISTORY_FILE_MAGIC. */
+  uint32_t version;        /**< HISTORY_FILE_VERSION, bumped whenever the layout changes. */
+  uint32_t count;          /**< The number of entries in the table. */
+  uint32_t reserved;       /**< 0. */
+  uint64_t strings_length; /**< The length of the strings of the table. */
+} HistoryFileHeader;
+
+/**
+ * @struct HistoryFileEntry
+ * @brief A history entry: a line and how it ran.
+ */
+typedef struct HistoryFileEntry
+{
+  int64_t time;            /**< When the line was run, in seconds since the epoch, 0 if unknown. */
+  int64_t duration_us;     /**< How long it ran, in microseconds, -1 if unknown. */
+  uint32_t line;           /**< The offset of the line in the strings. */
+  uint32_t cwd;            /**< The offset of the directory it ran in, an empty string if unknown. */
+  int32_t status;          /**< Its exit status, -1 if unknown. */
+  uint32_t strings_length; /**< For an appended record, the length of the strings that follow it, 0 in the table. */
+} HistoryFileEntry;
+
+// Function Prototypes
+int history_file_load(const char *filename, int max_length);
+void history_file_begin(const char *line, const char *cwd);
+void history_file_finish(int status);
+int history_file_export(const char *filename);
+void history_file_list(FILE *out);
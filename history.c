@@ -0,0 +1,865 @@
+/***************************************************************************/ /**
+   @file         history.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "history.h"
+#include "fuzzy.h"
+
+/**
+ * @brief Root of the history index.
+ *
+ * Every node caches the highest ranked line of its subtree. A line's rank only goes up
+ * when it is used again, so a use only has to update the nodes on the path to the line,
+ * and a prefix lookup only has to walk down the trie.
+ */
+static HistoryNode root;
+
+/**
+ * @brief The history entries, in a hash table keyed by their line, and the file their
+ * uses are saved to.
+ *
+ * The file is a log: every use appends a "<time> <count> <line>" record, and records of
+ * the same line add up. Once it holds HISTORY_USES_COMPACT_FACTOR times as many records
+ * as there are entries, it is rewritten with one record per entry.
+ *
+ * The entry of every line held by linenoise is also kept in the order the lines were
+ * added. linenoise always drops its oldest line, so the entry of a dropped line is the
+ * oldest one there, whatever its text has become while the history was edited. Dropped
+ * entries are skipped until they make up half of the array, then the others are moved
+ * down over them.
+ */
+static struct
+{
+    HistoryEntry **slots;  /**< The entries, open addressing with linear probing. */
+    size_t capacity;       /**< The number of slots, a power of two. */
+    size_t count;          /**< The number of entries. */
+    unsigned long order;   /**< The order of the last use. */
+    char *path;            /**< The file the uses are saved to, or NULL. */
+    size_t records;        /**< The number of records in the file. */
+    HistoryEntry **held;   /**< The entry of every line held by linenoise, oldest first. */
+    size_t held_first;     /**< The oldest entry still held, the ones below it were dropped. */
+    size_t held_count;     /**< The number of entries in held, including the dropped ones. */
+    size_t held_capacity;  /**< The number of allocated entries in held. */
+} entries;
+
+/**
+ * Returns the rank of an entry: its use count, weighed down by half every
+ * HISTORY_HALF_LIFE seconds since its last use. The log of that is compared, since
+ * log2(count) - (now - last_used) / HISTORY_HALF_LIFE ranks lines the same way without
+ * the current time, so a rank does not change until the line is used again.
+ *
+ * @param entry The entry.
+ * @return The rank, higher is better.
+ */
+static double entry_frecency(const HistoryEntry *entry)
+{
+    return log2(entry->count) + (double)entry->last_used / HISTORY_HALF_LIFE;
+}
+
+/**
+ * Checks whether an entry ranks above another: a higher frecency, or the same one and a
+ * more recent use.
+ *
+ * @param a The entry.
+ * @param b The other entry, may be NULL.
+ * @return true if a ranks above b.
+ */
+static bool ranks_above(const HistoryEntry *a, const HistoryEntry *b)
+{
+    return b == NULL || a->frecency > b->frecency || (a->frecency == b->frecency && a->order > b->order);
+}
+
+/**
+ * Hashes a line with FNV-1a.
+ */
+static uint64_t hash_line(const char *line)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)line; *p != '\0'; p++)
+    {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Finds the slot of a line in the hash table.
+ *
+ * @param line The line.
+ * @return The slot holding the line's entry, or the empty slot where it belongs.
+ */
+static HistoryEntry **find_slot(const char *line)
+{
+    size_t i = hash_line(line) & (entries.capacity - 1);
+
+    while (entries.slots[i] != NULL && strcmp(entries.slots[i]->line, line) != 0)
+    {
+        i = (i + 1) & (entries.capacity - 1);
+    }
+
+    return &entries.slots[i];
+}
+
+/**
+ * Moves the entries to a new hash table.
+ *
+ * @param capacity The number of slots of the new table, a power of two.
+ * @param held_only Whether to free the entries whose line is not in the history instead.
+ */
+static void rehash_entries(size_t capacity, bool held_only)
+{
+    HistoryEntry **old = entries.slots;
+    size_t old_capacity = entries.capacity;
+
+    entries.capacity = capacity;
+    entries.slots = calloc(entries.capacity, sizeof(HistoryEntry *));
+    if (entries.slots == NULL)
+    {
+        perror("Error allocating memory for history index");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        if (old[i] == NULL)
+        {
+            continue;
+        }
+        if (held_only && old[i]->held == 0)
+        {
+            free(old[i]->line);
+            free(old[i]);
+            entries.count--;
+            continue;
+        }
+        *find_slot(old[i]->line) = old[i];
+    }
+    free(old);
+}
+
+/**
+ * Doubles the hash table, or allocates it.
+ */
+static void grow_entries(void)
+{
+    rehash_entries(entries.capacity ? entries.capacity * 2 : HISTORY_TABLE_SIZE, false);
+}
+
+/**
+ * Empties a slot of the hash table, moving the entries after it that would no longer
+ * be found back into it.
+ *
+ * @param slot The slot.
+ */
+static void remove_slot(HistoryEntry **slot)
+{
+    size_t mask = entries.capacity - 1;
+    size_t hole = slot - entries.slots;
+
+    for (size_t i = (hole + 1) & mask; entries.slots[i] != NULL; i = (i + 1) & mask)
+    {
+        // An entry can fill the hole unless its home slot is after the hole
+        size_t home = hash_line(entries.slots[i]->line) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            entries.slots[hole] = entries.slots[i];
+            hole = i;
+        }
+    }
+    entries.slots[hole] = NULL;
+}
+
+/**
+ * Creates a new trie node.
+ *
+ * @param label The edge label leading to the node.
+ * @param label_length The length of the edge label.
+ * @param entry The history line ending at the node, or NULL.
+ * @param best The highest ranked history line in the node's subtree.
+ * @return A pointer to the newly created node.
+ */
+static HistoryNode *new_history_node(const char *label, size_t label_length, HistoryEntry *entry, HistoryEntry *best)
+{
+    HistoryNode *node = malloc(sizeof(HistoryNode));
+    if (node == NULL)
+    {
+        perror("Error allocating memory for history index");
+        exit(EXIT_FAILURE);
+    }
+
+    node->label = label;
+    node->label_length = label_length;
+    node->entry = entry;
+    node->best = best;
+    node->child = NULL;
+    node->sibling = NULL;
+    return node;
+}
+
+/**
+ * Finds the link pointing to the child of a node whose label starts with a given byte.
+ * If there is no such child, the returned link is where it should be inserted.
+ *
+ * @param node The parent node.
+ * @param c The first byte of the label.
+ * @return A pointer to the link (child or sibling pointer) for the byte.
+ */
+static HistoryNode **find_child(HistoryNode *node, char c)
+{
+    HistoryNode **link = &node->child;
+
+    while (*link != NULL && (unsigned char)(*link)->label[0] < (unsigned char)c)
+    {
+        link = &(*link)->sibling;
+    }
+
+    return link;
+}
+
+/**
+ * Walks down the trie along a prefix.
+ *
+ * @param prefix The prefix to look up.
+ * @return The node whose subtree holds every line starting with the prefix, or NULL if there is none.
+ */
+static HistoryNode *find_prefix(const char *prefix)
+{
+    HistoryNode *node = &root;
+    const char *p = prefix;
+
+    while (*p != '\0')
+    {
+        HistoryNode *child = *find_child(node, *p);
+        if (child == NULL || child->label[0] != *p)
+        {
+            return NULL;
+        }
+
+        size_t i = 0;
+        while (i < child->label_length && p[i] != '\0' && p[i] == child->label[i])
+        {
+            i++;
+        }
+
+        if (i < child->label_length && p[i] != '\0')
+        {
+            return NULL;
+        }
+
+        p += i;
+        node = child;
+    }
+
+    return node;
+}
+
+/**
+ * Inserts the line of a new entry into the trie, and makes it the best line of the
+ * nodes on its path whose best line it ranks above.
+ *
+ * @param entry The entry.
+ */
+static void insert_line(HistoryEntry *entry)
+{
+    HistoryNode *node = &root;
+    const char *p = entry->line;
+
+    while (true)
+    {
+        if (ranks_above(entry, node->best))
+        {
+            node->best = entry;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        HistoryNode **link = find_child(node, *p);
+        HistoryNode *child = *link;
+
+        if (child == NULL || child->label[0] != *p)
+        {
+            // No edge starts with this byte, hang the rest of the line off a new leaf
+            HistoryNode *leaf = new_history_node(p, strlen(p), entry, entry);
+            leaf->sibling = child;
+            *link = leaf;
+            return;
+        }
+
+        size_t common = 0;
+        while (common < child->label_length && p[common] == child->label[common])
+        {
+            common++;
+        }
+
+        if (common < child->label_length)
+        {
+            // Split the edge, the new inner node has the same lines as the existing child
+            HistoryNode *inner = new_history_node(child->label, common, NULL, child->best);
+            inner->child = child;
+            inner->sibling = child->sibling;
+            child->label += common;
+            child->label_length -= common;
+            child->sibling = NULL;
+            *link = inner;
+            child = inner;
+        }
+
+        p += common;
+        node = child;
+    }
+
+    node->entry = entry;
+}
+
+/**
+ * Makes an entry the best line of the nodes on its path whose best line it now ranks above.
+ *
+ * @param entry The entry, whose rank just went up.
+ */
+static void promote(HistoryEntry *entry)
+{
+    HistoryNode *node = &root;
+    const char *p = entry->line;
+
+    while (true)
+    {
+        if (ranks_above(entry, node->best))
+        {
+            node->best = entry;
+        }
+        if (*p == '\0')
+        {
+            return;
+        }
+
+        node = *find_child(node, *p);
+        p += node->label_length;
+    }
+}
+
+/**
+ * Removes the line of an entry from a subtree of the trie, and updates the best line of
+ * the nodes on its path. Labels point into the line of the entry that created them, so
+ * the labels on the path are moved to the best line left below them, which has the
+ * same prefix.
+ *
+ * @param node The root of the subtree, on the line's path.
+ * @param p The rest of the line after the node's label.
+ * @param entry The entry.
+ * @return true if no line is left in the subtree.
+ */
+static bool remove_line(HistoryNode *node, const char *p, const HistoryEntry *entry)
+{
+    if (*p == '\0')
+    {
+        node->entry = NULL;
+    }
+    else
+    {
+        HistoryNode **link = find_child(node, *p);
+        HistoryNode *child = *link;
+
+        if (remove_line(child, p + child->label_length, entry))
+        {
+            *link = child->sibling;
+            free(child);
+        }
+        else
+        {
+            child->label = child->best->line + (p - entry->line);
+        }
+    }
+
+    node->best = node->entry;
+    for (HistoryNode *child = node->child; child != NULL; child = child->sibling)
+    {
+        if (ranks_above(child->best, node->best))
+        {
+            node->best = child->best;
+        }
+    }
+    return node->best == NULL;
+}
+
+/**
+ * Counts a copy of a line in the history, adding the line to the trie and to the lines
+ * searched by Ctrl-R.
+ *
+ * @param entry The entry of the line.
+ */
+static void hold_line(HistoryEntry *entry)
+{
+    if (entries.held_count == entries.held_capacity)
+    {
+        entries.held_capacity = entries.held_capacity ? entries.held_capacity * 2 : HISTORY_TABLE_SIZE;
+        entries.held = realloc(entries.held, sizeof(HistoryEntry *) * entries.held_capacity);
+        if (entries.held == NULL)
+        {
+            perror("Error allocating memory for history index");
+            exit(EXIT_FAILURE);
+        }
+    }
+    entries.held[entries.held_count++] = entry;
+
+    if (entry->held++ == 0)
+    {
+        insert_line(entry);
+    }
+    fuzzy_index_add(entry->line);
+}
+
+/**
+ * Counts uses of a line and updates its rank, adding an entry for the line if it is new.
+ * Uses without a time only count for lines that have no use with a time: those come
+ * from the history file, which also holds the lines whose uses were saved.
+ *
+ * @param line The line.
+ * @param count The number of uses.
+ * @param when The time of the last of them, 0 if it is not known.
+ * @return The entry of the line.
+ */
+static HistoryEntry *add_uses(const char *line, unsigned int count, time_t when)
+{
+    if (entries.count * 2 >= entries.capacity)
+    {
+        grow_entries();
+    }
+
+    HistoryEntry **slot = find_slot(line);
+    HistoryEntry *entry = *slot;
+    if (entry == NULL)
+    {
+        entry = calloc(1, sizeof(HistoryEntry));
+        if (entry == NULL || (entry->line = strdup(line)) == NULL)
+        {
+            perror("Error allocating memory for history index");
+            exit(EXIT_FAILURE);
+        }
+        *slot = entry;
+        entries.count++;
+    }
+
+    if (when != 0 || entry->last_used == 0)
+    {
+        entry->count += count;
+    }
+    entry->last_used = when > entry->last_used ? when : entry->last_used;
+    entry->order = ++entries.order;
+    entry->frecency = entry_frecency(entry);
+
+    if (entry->held > 0)
+    {
+        promote(entry);
+    }
+    return entry;
+}
+
+/**
+ * Reads the uses saved next to the history file.
+ */
+static void load_uses(void)
+{
+    FILE *fp = fopen(entries.path, "r");
+    if (fp == NULL)
+    {
+        return;
+    }
+
+    char *record = NULL;
+    size_t size = 0;
+    ssize_t length;
+    while ((length = getline(&record, &size, fp)) > 0)
+    {
+        char *p;
+        if (record[length - 1] == '\n')
+        {
+            record[length - 1] = '\0';
+        }
+
+        entries.records++;
+        time_t when = (time_t)strtoll(record, &p, 10);
+        if (*p != ' ')
+        {
+            continue;
+        }
+        unsigned long count = strtoul(p + 1, &p, 10);
+        if (*p != ' ' || p[1] == '\0' || count == 0)
+        {
+            continue;
+        }
+
+        add_uses(p + 1, (unsigned int)count, when);
+    }
+
+    free(record);
+    fclose(fp);
+}
+
+/**
+ * Rewrites the uses file with one record per entry that was ever run.
+ */
+static void save_uses(void)
+{
+    size_t length = strlen(entries.path) + 5;
+    char *tmpname = malloc(length);
+    if (tmpname == NULL)
+    {
+        return;
+    }
+    snprintf(tmpname, length, "%s.tmp", entries.path);
+
+    mode_t old_umask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    FILE *fp = fopen(tmpname, "w");
+    umask(old_umask);
+    if (fp == NULL)
+    {
+        free(tmpname);
+        return;
+    }
+
+    size_t records = 0;
+    for (size_t i = 0; i < entries.capacity; i++)
+    {
+        HistoryEntry *entry = entries.slots[i];
+        if (entry != NULL && entry->last_used != 0)
+        {
+            fprintf(fp, "%lld %u %s\n", (long long)entry->last_used, entry->count, entry->line);
+            records++;
+        }
+    }
+
+    if (fclose(fp) != 0 || rename(tmpname, entries.path) == -1)
+    {
+        unlink(tmpname);
+    }
+    else
+    {
+        entries.records = records;
+    }
+    free(tmpname);
+}
+
+/**
+ * Appends a use to the uses file, and compacts the file when it holds too many records.
+ *
+ * @param entry The entry that was used.
+ * @param when The time of the use.
+ */
+static void append_use(const HistoryEntry *entry, time_t when)
+{
+    mode_t old_umask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    int fd = open(entries.path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    umask(old_umask);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    // One write, so records of shells sharing the file do not interleave
+    size_t size = strlen(entry->line) + 32;
+    char *record = malloc(size);
+    if (record != NULL)
+    {
+        int length = snprintf(record, size, "%lld 1 %s\n", (long long)when, entry->line);
+        if (write(fd, record, length) == length)
+        {
+            entries.records++;
+        }
+        free(record);
+    }
+    close(fd);
+
+    if (entries.records > entries.count * HISTORY_USES_COMPACT_FACTOR)
+    {
+        save_uses();
+    }
+}
+
+/**
+ * Adds a line of the history file to the history index and to the lines searched by
+ * Ctrl-R. Every time a line appears in the history counts as a use, unless its uses
+ * were saved with their time.
+ *
+ * @param line The history line to be added.
+ */
+void history_index_add(const char *line)
+{
+    hold_line(add_uses(line, 1, 0));
+}
+
+/**
+ * Records that a line was just run: it counts as a use, now, and the use is saved next
+ * to the history file.
+ *
+ * @param line The line that was run.
+ */
+void history_index_use(const char *line)
+{
+    // The line is only held if linenoise keeps it, it does not repeat its last line
+    int length = linenoiseHistoryLength();
+    bool repeated = length > 0 && strcmp(linenoiseHistoryGet(length - 1), line) == 0;
+
+    time_t now = time(NULL);
+    HistoryEntry *entry = add_uses(line, 1, now);
+    if (!repeated)
+    {
+        hold_line(entry);
+    }
+    if (entries.path != NULL)
+    {
+        append_use(entry, now);
+    }
+}
+
+/**
+ * Removes the oldest line held by linenoise, when linenoise drops it. Once no copy of
+ * the line is left, it is no longer offered, and its entry and uses are forgotten.
+ */
+void history_index_evict(void)
+{
+    if (entries.held_first == entries.held_count)
+    {
+        return;
+    }
+
+    HistoryEntry *entry = entries.held[entries.held_first++];
+    if (entries.held_first >= entries.held_count / 2)
+    {
+        entries.held_count -= entries.held_first;
+        memmove(entries.held, entries.held + entries.held_first, sizeof(HistoryEntry *) * entries.held_count);
+        entries.held_first = 0;
+    }
+
+    fuzzy_index_remove();
+    if (--entry->held > 0)
+    {
+        return;
+    }
+
+    remove_line(&root, entry->line, entry);
+    remove_slot(find_slot(entry->line));
+    entries.count--;
+    free(entry->line);
+    free(entry);
+}
+
+/**
+ * Builds the history index from the uses saved next to a history file and the entries
+ * currently held by linenoise. Uses of lines that are no longer in the history are
+ * dropped.
+ *
+ * @param filename The history file, the uses are read from and saved to it with
+ * HISTORY_USES_SUFFIX appended.
+ */
+void history_index_load(const char *filename)
+{
+    size_t length = strlen(filename) + sizeof(HISTORY_USES_SUFFIX);
+    free(entries.path);
+    entries.path = malloc(length);
+    if (entries.path != NULL)
+    {
+        snprintf(entries.path, length, "%s%s", filename, HISTORY_USES_SUFFIX);
+        load_uses();
+    }
+
+    // Size the hash table for the whole history at once, it is not rehashed while loading
+    int count = linenoiseHistoryLength();
+    while (entries.capacity < (entries.count + count) * 2)
+    {
+        grow_entries();
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        history_index_add(linenoiseHistoryGet(i));
+    }
+    if (entries.slots != NULL)
+    {
+        rehash_entries(entries.capacity, true);
+    }
+}
+
+/**
+ * Returns the highest ranked history line starting with a prefix.
+ *
+ * @param prefix The prefix typed by the user.
+ * @return The matching history line, or NULL if there is none. The string is owned by the index.
+ */
+const char *history_index_hint(const char *prefix)
+{
+    HistoryNode *node = find_prefix(prefix);
+    return node != NULL && node->best != NULL ? node->best->line : NULL;
+}
+
+/**
+ * @brief A subtree of the trie waiting in the completion heap, or a single line when
+ * node is NULL. Either way, best is the highest ranked line it holds.
+ */
+typedef struct
+{
+    HistoryEntry *best;  /**< The highest ranked line. */
+    HistoryNode *node;   /**< The subtree, or NULL for the line alone. */
+} HeapItem;
+
+/**
+ * Adds an item to a max-heap of subtrees ordered by their best line.
+ *
+ * @param heap The heap, grown as needed.
+ * @param count The number of items, updated.
+ * @param capacity The number of allocated items, updated.
+ * @param item The item.
+ */
+static void heap_push(HeapItem **heap, size_t *count, size_t *capacity, HeapItem item)
+{
+    if (*count == *capacity)
+    {
+        *capacity = *capacity ? *capacity * 2 : HISTORY_MAX_COMPLETIONS * 4;
+        *heap = realloc(*heap, sizeof(HeapItem) * *capacity);
+        if (*heap == NULL)
+        {
+            perror("Error allocating memory for completion");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    size_t i = (*count)++;
+    while (i > 0 && ranks_above(item.best, (*heap)[(i - 1) / 2].best))
+    {
+        (*heap)[i] = (*heap)[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    (*heap)[i] = item;
+}
+
+/**
+ * Removes the top item of a max-heap of subtrees.
+ *
+ * @param heap The heap.
+ * @param count The number of items, updated.
+ * @return The item with the highest ranked line.
+ */
+static HeapItem heap_pop(HeapItem *heap, size_t *count)
+{
+    HeapItem top = heap[0];
+    HeapItem item = heap[--(*count)];
+    size_t i = 0;
+
+    while (2 * i + 1 < *count)
+    {
+        size_t child = 2 * i + 1;
+        if (child + 1 < *count && ranks_above(heap[child + 1].best, heap[child].best))
+        {
+            child++;
+        }
+        if (!ranks_above(heap[child].best, item.best))
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = item;
+
+    return top;
+}
+
+/**
+ * Adds the highest ranked history lines starting with a prefix to a completion list,
+ * best first, at most HISTORY_MAX_COMPLETIONS of them.
+ *
+ * Subtrees are expanded best first from a heap ordered by their cached best line, so
+ * only the nodes above the returned lines and their siblings are visited.
+ *
+ * @param prefix The prefix typed by the user.
+ * @param lc The completion list.
+ */
+void history_index_complete(const char *prefix, linenoiseCompletions *lc)
+{
+    HistoryNode *node = find_prefix(prefix);
+    if (node == NULL || node->best == NULL)
+    {
+        return;
+    }
+
+    HeapItem *heap = NULL;
+    size_t count = 0, capacity = 0, added = 0;
+    heap_push(&heap, &count, &capacity, (HeapItem){node->best, node});
+
+    while (count > 0 && added < HISTORY_MAX_COMPLETIONS)
+    {
+        HeapItem item = heap_pop(heap, &count);
+        if (item.node == NULL)
+        {
+            linenoiseAddCompletion(lc, item.best->line);
+            added++;
+            continue;
+        }
+
+        if (item.node->entry != NULL)
+        {
+            heap_push(&heap, &count, &capacity, (HeapItem){item.node->entry, NULL});
+        }
+        for (HistoryNode *child = item.node->child; child != NULL; child = child->sibling)
+        {
+            heap_push(&heap, &count, &capacity, (HeapItem){child->best, child});
+        }
+    }
+
+    free(heap);
+}
+
+/**
+ * Frees a subtree of the history index.
+ *
+ * @param node The root of the subtree.
+ */
+static void free_history_nodes(HistoryNode *node)
+{
+    HistoryNode *child = node->child;
+
+    while (child != NULL)
+    {
+        HistoryNode *next = child->sibling;
+        free_history_nodes(child);
+        free(child);
+        child = next;
+    }
+}
+
+/**
+ * Frees the memory allocated for the history index.
+ */
+void free_history_index(void)
+{
+    free_fuzzy_index();
+    free_history_nodes(&root);
+    memset(&root, 0, sizeof(root));
+
+    for (size_t i = 0; i < entries.capacity; i++)
+    {
+        if (entries.slots[i] != NULL)
+        {
+            free(entries.slots[i]->line);
+            free(entries.slots[i]);
+        }
+    }
+    free(entries.slots);
+    free(entries.path);
+    free(entries.held);
+    memset(&entries, 0, sizeof(entries));
+}
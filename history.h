@@ -0,0 +1,59 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         history.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stddef.h>
+#include <time.h>
+#include "linenoise.h"
+
+// Macros
+#define HISTORY_TABLE_SIZE 1024            // Slots of the entry hash table at first
+#define HISTORY_HALF_LIFE (3 * 24 * 3600)  // Seconds after which a use counts half as much
+#define HISTORY_MAX_COMPLETIONS 16         // History lines offered by a completion
+#define HISTORY_USES_SUFFIX ".frecency"    // Appended to the history file name for the use counts
+#define HISTORY_USES_COMPACT_FACTOR 2      // Records per entry at which the use counts are rewritten
+
+/**
+ * @struct HistoryEntry
+ * @brief A unique history line and how often and how recently it was run.
+ */
+typedef struct
+{
+  char *line;            /**< The history line. */
+  unsigned int count;    /**< The number of times the line was run, or appears in the history file. */
+  time_t last_used;      /**< When the line was last run, 0 if it is only known from the history file. */
+  unsigned long order;   /**< The order of the last use, later uses are higher. */
+  double frecency;       /**< The rank of the line, see entry_frecency(). */
+  unsigned int held;     /**< The number of copies of the line in the history, it is in the trie while there is one. */
+} HistoryEntry;
+
+/**
+ * @struct HistoryNode
+ * @brief A node of the radix trie used to index history lines by prefix.
+ *
+ * Edge labels point into the lines of the entries, so the trie holds one copy per unique line.
+ */
+typedef struct HistoryNode
+{
+  const char *label;           /**< The edge label leading to this node (not NUL terminated). */
+  size_t label_length;         /**< The length of the edge label. */
+  HistoryEntry *entry;         /**< The history line ending at this node, or NULL. */
+  HistoryEntry *best;          /**< The highest ranked history line in this subtree. */
+  struct HistoryNode *child;   /**< The first child, children are sorted by their first byte. */
+  struct HistoryNode *sibling; /**< The next sibling. */
+} HistoryNode;
+
+// Function Prototypes
+void history_index_load(const char *filename);
+void history_index_add(const char *line);
+void history_index_use(const char *line);
+void history_index_evict(void);
+const char *history_index_hint(const char *prefix);
+void history_index_complete(const char *prefix, linenoiseCompletions *lc);
+void free_history_index(void);
@@ -0,0 +1,463 @@
+/***************************************************************************/ /**
+   @file         jobs.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "jobs.h"
+
+/**
+ * @brief The job table.
+ *
+ * Children are reaped by the SIGCHLD handler as soon as they change state, and their
+ * status is recorded in the job they belong to. The table is only changed with SIGCHLD
+ * blocked, so the handler never sees it half updated.
+ */
+static struct
+{
+    job_t **jobs;  /**< The jobs, in the order they were started. */
+    int count;     /**< The number of jobs. */
+    int capacity;  /**< The number of allocated slots. */
+} table;
+
+/**
+ * Converts a wait() status into a shell exit status.
+ *
+ * @param status The status reported by waitpid().
+ * @return The exit code, or 128 plus the signal number if the process was killed by a signal.
+ */
+static int exit_status(int status)
+{
+    if (WIFEXITED(status))
+    {
+        return WEXITSTATUS(status);
+    }
+
+    if (WIFSIGNALED(status))
+    {
+        return 128 + WTERMSIG(status);
+    }
+
+    return 1;
+}
+
+/**
+ * Records a state change of a child in its job.
+ *
+ * @param pid The child.
+ * @param status The status reported by waitpid().
+ */
+static void update_job(pid_t pid, int status)
+{
+    for (int j = 0; j < table.count; j++)
+    {
+        job_t *job = table.jobs[j];
+
+        for (int i = 0; i < job->stage_count; i++)
+        {
+            if (job->pids[i] != pid)
+            {
+                continue;
+            }
+
+            if (WIFSTOPPED(status))
+            {
+                job->state = JOB_STOPPED;
+                job->notified = false;
+            }
+            else if (WIFCONTINUED(status))
+            {
+                job->state = JOB_RUNNING;
+            }
+            else if (job->statuses[i] == -1)
+            {
+                job->statuses[i] = exit_status(status);
+                if (--job->live == 0)
+                {
+                    job->state = JOB_DONE;
+                    job->notified = false;
+                }
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Reaps every child that changed state, without blocking.
+ *
+ * @param sig The signal number (SIGCHLD).
+ */
+static void sigchld_handler(int sig)
+{
+    int saved_errno = errno;
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG | WUNTRACED | WCONTINUED)) > 0)
+    {
+        update_job(pid, status);
+    }
+
+    errno = saved_errno;
+}
+
+/**
+ * Installs the SIGCHLD handler that reaps children.
+ */
+void jobs_init(void)
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sigchld_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, NULL);
+}
+
+/**
+ * Blocks SIGCHLD, so the job table can be changed and children started before they can be reaped.
+ */
+void jobs_block(void)
+{
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, NULL);
+}
+
+/**
+ * Unblocks SIGCHLD, children that changed state in the meantime are reaped right away.
+ */
+void jobs_unblock(void)
+{
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &set, NULL);
+}
+
+/**
+ * Adds a job to the table. SIGCHLD must be blocked since before its processes were started.
+ *
+ * @param pgid The process group of the job.
+ * @param pids The pid of every stage, -1 for a stage that could not be started.
+ * @param stage_count The number of stages.
+ * @param command The command line of the job, owned by the job from now on.
+ * @param background Whether the job runs in the background.
+ * @return The job.
+ */
+job_t *jobs_add(pid_t pgid, pid_t *pids, int stage_count, char *command, bool background)
+{
+    job_t *job = malloc(sizeof(job_t));
+    pid_t *job_pids = malloc(sizeof(pid_t) * (stage_count > 0 ? stage_count : 1));
+    int *statuses = malloc(sizeof(int) * (stage_count > 0 ? stage_count : 1));
+    if (job == NULL || job_pids == NULL || statuses == NULL)
+    {
+        perror("Error allocating memory for job");
+        exit(EXIT_FAILURE);
+    }
+
+    if (table.count == table.capacity)
+    {
+        int capacity = table.capacity ? table.capacity * 2 : JOBS_INITIAL_CAPACITY;
+        job_t **jobs = realloc(table.jobs, sizeof(job_t *) * capacity);
+        if (jobs == NULL)
+        {
+            perror("Error allocating memory for job table");
+            exit(EXIT_FAILURE);
+        }
+        table.jobs = jobs;
+        table.capacity = capacity;
+    }
+
+    job->id = table.count > 0 ? table.jobs[table.count - 1]->id + 1 : 1;
+    job->pgid = pgid;
+    job->pids = job_pids;
+    job->statuses = statuses;
+    job->stage_count = stage_count;
+    job->live = 0;
+    job->command = command;
+    job->background = background;
+    job->notified = false;
+    clock_gettime(CLOCK_MONOTONIC, &job->start);
+
+    for (int i = 0; i < stage_count; i++)
+    {
+        job_pids[i] = pids[i];
+        statuses[i] = pids[i] > 0 ? -1 : 127; // reported as 127 (command not found / not started)
+        job->live += pids[i] > 0;
+    }
+
+    job->state = job->live > 0 ? JOB_RUNNING : JOB_DONE;
+    table.jobs[table.count++] = job;
+
+    return job;
+}
+
+/**
+ * Waits until a job is no longer running, i.e. it exited or was stopped. SIGCHLD must be blocked.
+ *
+ * @param job The job.
+ */
+void jobs_wait(job_t *job)
+{
+    while (job->state == JOB_RUNNING)
+    {
+        jobs_wait_any();
+    }
+}
+
+/**
+ * Waits for the next SIGCHLD. SIGCHLD must be blocked.
+ */
+void jobs_wait_any(void)
+{
+    sigset_t set;
+
+    sigprocmask(SIG_SETMASK, NULL, &set);
+    sigdelset(&set, SIGCHLD);
+    sigsuspend(&set);
+}
+
+/**
+ * Returns the current job, the most recently started one.
+ *
+ * @return The job, or NULL if there are no jobs.
+ */
+job_t *jobs_current(void)
+{
+    return table.count > 0 ? table.jobs[table.count - 1] : NULL;
+}
+
+/**
+ * Looks up a job by a job specification: "%n" for job n, "%%", "%+" or "%" for the
+ * current job, or the pid of one of its processes.
+ *
+ * @param spec The job specification, NULL for the current job.
+ * @return The job, or NULL if there is no such job.
+ */
+job_t *jobs_find(const char *spec)
+{
+    if (spec == NULL || strcmp(spec, "%") == 0 || strcmp(spec, "%%") == 0 || strcmp(spec, "%+") == 0)
+    {
+        return jobs_current();
+    }
+
+    char *end;
+    long number = strtol(spec[0] == '%' ? spec + 1 : spec, &end, 10);
+    if (*end != '\0' || number <= 0)
+    {
+        return NULL;
+    }
+
+    if (spec[0] != '%')
+    {
+        return jobs_find_pid((pid_t)number);
+    }
+
+    for (int j = 0; j < table.count; j++)
+    {
+        if (table.jobs[j]->id == number)
+        {
+            return table.jobs[j];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Looks up the job a process belongs to.
+ *
+ * @param pid The pid of the process.
+ * @return The job, or NULL if there is no such job.
+ */
+job_t *jobs_find_pid(pid_t pid)
+{
+    for (int j = 0; j < table.count; j++)
+    {
+        for (int i = 0; i < table.jobs[j]->stage_count; i++)
+        {
+            if (table.jobs[j]->pids[i] == pid)
+            {
+                return table.jobs[j];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns the number of jobs in the table.
+ *
+ * @return The number of jobs.
+ */
+int jobs_count(void)
+{
+    return table.count;
+}
+
+/**
+ * Returns a job by its position in the table.
+ *
+ * @param index The position, from 0 to jobs_count() - 1.
+ * @return The job.
+ */
+job_t *jobs_get(int index)
+{
+    return table.jobs[index];
+}
+
+/**
+ * Removes a job from the table and frees it. SIGCHLD must be blocked.
+ *
+ * @param job The job.
+ */
+void jobs_remove(job_t *job)
+{
+    for (int j = 0; j < table.count; j++)
+    {
+        if (table.jobs[j] == job)
+        {
+            memmove(&table.jobs[j], &table.jobs[j + 1], sizeof(job_t *) * (table.count - j - 1));
+            table.count--;
+            break;
+        }
+    }
+
+    free(job->pids);
+    free(job->statuses);
+    free(job->command);
+    free(job);
+}
+
+/**
+ * Returns the exit status of a job, the status of its last stage.
+ *
+ * @param job The job.
+ * @return The exit status, or -1 while the last stage is running.
+ */
+int job_status(job_t *job)
+{
+    return job->stage_count > 0 ? job->statuses[job->stage_count - 1] : 0;
+}
+
+/**
+ * Describes the state of a job, e.g. "Running" or "Exit 2".
+ *
+ * @param job The job.
+ * @param buffer The buffer for the description.
+ * @param size The size of the buffer.
+ */
+static void describe_state(job_t *job, char *buffer, size_t size)
+{
+    switch (job->state)
+    {
+    case JOB_RUNNING:
+        snprintf(buffer, size, "Running");
+        break;
+    case JOB_STOPPED:
+        snprintf(buffer, size, "Stopped");
+        break;
+    case JOB_DONE:
+        if (job_status(job) == 0)
+        {
+            snprintf(buffer, size, "Done");
+        }
+        else
+        {
+            snprintf(buffer, size, "Exit %d", job_status(job));
+        }
+        break;
+    }
+}
+
+/**
+ * Prints a line about a job, e.g. "[1]+  Running                 sleep 10 &".
+ *
+ * @param job The job.
+ * @param elapsed Whether to include the time since the job was started.
+ */
+static void print_job(job_t *job, bool elapsed)
+{
+    char state[32];
+    describe_state(job, state, sizeof(state));
+
+    printf("[%d]%c  %-8s", job->id, job == jobs_current() ? '+' : ' ', state);
+
+    if (elapsed)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        printf(" %6lds  %6ld", (long)(now.tv_sec - job->start.tv_sec), (long)job->pgid);
+    }
+
+    printf("  %s\n", job->command);
+}
+
+/**
+ * Reports background jobs that finished or stopped since the last report, and removes
+ * the finished ones. Called before every prompt, and after every line of a script.
+ * SIGCHLD must be blocked.
+ *
+ * @param print Whether to print the report, false when running a script.
+ */
+void jobs_notify(bool print)
+{
+    for (int j = 0; j < table.count; j++)
+    {
+        job_t *job = table.jobs[j];
+
+        if (job->notified || job->state == JOB_RUNNING)
+        {
+            continue;
+        }
+
+        if (print)
+        {
+            print_job(job, false);
+        }
+        job->notified = true;
+
+        if (job->state == JOB_DONE)
+        {
+            jobs_remove(job);
+            j--;
+        }
+    }
+}
+
+/**
+ * Prints every job with its state, run time and process group ("jobs"). SIGCHLD must be blocked.
+ */
+void jobs_print(void)
+{
+    for (int j = 0; j < table.count; j++)
+    {
+        print_job(table.jobs[j], true);
+        table.jobs[j]->notified = true;
+    }
+
+    // Finished jobs have now been reported
+    for (int j = 0; j < table.count; j++)
+    {
+        if (table.jobs[j]->state == JOB_DONE)
+        {
+            jobs_remove(table.jobs[j]);
+            j--;
+        }
+    }
+}
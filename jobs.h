@@ -0,0 +1,77 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         jobs.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Macros
+#define JOBS_INITIAL_CAPACITY 16
+
+/**
+ * @brief Enumeration representing the states of a job.
+ */
+typedef enum JobState
+{
+  JOB_RUNNING, // At least one process of the job is running
+  JOB_STOPPED, // The job was stopped, e.g. with Ctrl-Z
+  JOB_DONE     // Every process of the job has exited
+} job_state_t;
+
+/**
+ * @struct Job
+ * @brief A pipeline started by the shell, in the foreground or in the background.
+ *
+ * Jobs are updated by the SIGCHLD handler, so they must only be changed while SIGCHLD
+ * is blocked (see jobs_block()).
+ */
+typedef struct Job
+{
+  int id;                 /**< The job number, as in "%1". */
+  pid_t pgid;             /**< The process group of the job. */
+  pid_t *pids;            /**< The pid of every stage, -1 for a stage that could not be started. */
+  int *statuses;          /**< The exit status of every stage, -1 while it is running. */
+  int stage_count;        /**< The number of stages. */
+  int live;               /**< The number of stages that have not exited yet. */
+  char *command;          /**< The command line of the job. */
+  job_state_t state;      /**< The state of the job. */
+  bool background;        /**< Whether the job runs in the background. */
+  bool notified;          /**< Whether the user was told about the current state. */
+  struct timespec start;  /**< When the job was started (CLOCK_MONOTONIC). */
+} job_t;
+
+/**
+ * @struct ParallelTask
+ * @brief A task of the parallel builtin, one run of the command for one argument.
+ */
+typedef struct ParallelTask
+{
+  job_t *job;  /**< The task's job while it runs. */
+  int out_fd;  /**< The file holding the task's grouped standard output, or -1. */
+  int err_fd;  /**< The file holding the task's grouped standard error, or -1. */
+  int status;  /**< The exit status of the task once it finished. */
+} parallel_task_t;
+
+// Function Prototypes
+void jobs_init(void);
+void jobs_block(void);
+void jobs_unblock(void);
+job_t *jobs_add(pid_t pgid, pid_t *pids, int stage_count, char *command, bool background);
+void jobs_wait(job_t *job);
+void jobs_wait_any(void);
+job_t *jobs_find(const char *spec);
+job_t *jobs_find_pid(pid_t pid);
+job_t *jobs_current(void);
+int jobs_count(void);
+job_t *jobs_get(int index);
+void jobs_remove(job_t *job);
+void jobs_notify(bool print);
+void jobs_print(void);
+int job_status(job_t *job);
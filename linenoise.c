@@ -49,7 +49,7 @@
  * - Win32 support
  *
  * Bloat:
- * - History search like Ctrl+r in readline?
+ * - History search like Ctrl+r in readline? (done, see searchLine())
  *
  * List of escape sequences used by this program, we do everything just
  * with three sequences. In order to be so cheap we may have some
@@ -114,15 +114,19 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include "linenoise.h"
 
 #define LINENOISE_DEFAULT_HISTORY_MAX_LEN 100
 #define LINENOISE_MAX_LINE 4096
+#define LINENOISE_HISTORY_COMPACT_FACTOR 2
 static char *unsupported_term[] = {"dumb","cons25","emacs",NULL};
 static linenoiseCompletionCallback *completionCallback = NULL;
 static linenoiseHintsCallback *hintsCallback = NULL;
 static linenoiseFreeHintsCallback *freeHintsCallback = NULL;
+static linenoiseSearchCallback *searchCallback = NULL;
+static linenoiseHistoryEvictCallback *historyEvictCallback = NULL;
 static char *linenoiseNoTTY(void);
 static void refreshLineWithCompletion(struct linenoiseState *ls, linenoiseCompletions *lc, int flags);
 static void refreshLineWithFlags(struct linenoiseState *l, int flags);
@@ -135,6 +139,10 @@ static int atexit_registered = 0; /* Register atexit just 1 time. */
 static int history_max_len = LINENOISE_DEFAULT_HISTORY_MAX_LEN;
 static int history_len = 0;
 static char **history = NULL;
+static int history_start = 0; /* Ring buffer slot of the oldest entry. */
+static int history_file_lines = 0; /* Lines in the history file, for compaction. */
+static const char *history_static = NULL; /* Memory holding entries linenoise does not own. */
+static size_t history_static_len = 0;
 
 enum KEY_ACTION{
 	KEY_NULL = 0,	    /* NULL */
@@ -144,6 +152,7 @@ enum KEY_ACTION{
 	CTRL_D = 4,         /* Ctrl-d */
 	CTRL_E = 5,         /* Ctrl-e */
 	CTRL_F = 6,         /* Ctrl-f */
+	CTRL_G = 7,         /* Ctrl-g */
 	CTRL_H = 8,         /* Ctrl-h */
 	TAB = 9,            /* Tab */
 	CTRL_K = 11,        /* Ctrl+k */
@@ -151,6 +160,7 @@ enum KEY_ACTION{
 	ENTER = 13,         /* Enter */
 	CTRL_N = 14,        /* Ctrl-n */
 	CTRL_P = 16,        /* Ctrl-p */
+	CTRL_R = 18,        /* Ctrl-r */
 	CTRL_T = 20,        /* Ctrl-t */
 	CTRL_U = 21,        /* Ctrl+u */
 	CTRL_W = 23,        /* Ctrl+w */
@@ -165,6 +175,22 @@ int linenoiseHistoryAdd(const char *line);
 #define REFRESH_ALL (REFRESH_CLEAN|REFRESH_WRITE) // Do both.
 static void refreshLine(struct linenoiseState *l);
 
+/* The history is stored in a ring buffer of history_max_len slots, so that
+ * adding an entry to a full history evicts the oldest one in O(1). Entries
+ * are addressed by their logical index, where 0 is the oldest entry and
+ * history_len-1 the newest one. */
+static char **historySlot(int index) {
+    return &history[(history_start+index) % history_max_len];
+}
+
+/* Free a history entry, unless it points into the memory registered with
+ * linenoiseHistorySetStatic(), which linenoise does not own. */
+static void historyFree(char *entry) {
+    if (entry >= history_static && entry < history_static+history_static_len)
+        return;
+    free(entry);
+}
+
 /* Debugging macro. */
 #if 0
 FILE *lndebug_fp = NULL;
@@ -455,6 +481,89 @@ void linenoiseSetFreeHintsCallback(linenoiseFreeHintsCallback *fn) {
     freeHintsCallback = fn;
 }
 
+/* Register a callback function to be called for Ctrl-R history search.
+ * It adds the lines matching the query, best match first, with
+ * linenoiseAddCompletion(). */
+void linenoiseSetSearchCallback(linenoiseSearchCallback *fn) {
+    searchCallback = fn;
+}
+
+/* Free the matches of the last search query. */
+static void freeSearchMatches(struct linenoiseState *l) {
+    freeCompletions(&l->search_matches);
+    l->search_matches.len = 0;
+    l->search_matches.cvec = NULL;
+}
+
+/* Run the search callback for the current query, and show the selected
+ * match in the buffer with a search prompt in place of the prompt. In
+ * multi line mode the best matches are listed below the line, see
+ * refreshSearchList(). */
+static void refreshSearch(struct linenoiseState *l) {
+    linenoiseCompletions lc = { 0, NULL };
+
+    freeSearchMatches(l);
+    if (l->search_len) searchCallback(l->search_query,&lc);
+    if (lc.len) {
+        if (l->search_idx >= lc.len) {
+            l->search_idx = lc.len-1;
+            linenoiseBeep();
+        }
+        snprintf(l->search_prompt,sizeof(l->search_prompt),
+            "(search %zu/%zu)`%s': ",l->search_idx+1,lc.len,l->search_query);
+        snprintf(l->buf,l->buflen,"%s",lc.cvec[l->search_idx]);
+        l->len = l->pos = strlen(l->buf);
+    } else {
+        snprintf(l->search_prompt,sizeof(l->search_prompt),"(%s)`%s': ",
+            l->search_len ? "failed search" : "search",l->search_query);
+        if (l->search_len) linenoiseBeep();
+    }
+    l->search_matches = lc;
+    refreshLine(l);
+}
+
+/* This is an helper function for linenoiseEdit*() and is called when the
+ * user types keys while in Ctrl-R search mode. Typed characters extend the
+ * query, backspace shortens it, Ctrl-R selects the next match, and Ctrl-G
+ * or Ctrl-C restore the line as it was before the search. Any other key
+ * accepts the selected match and is returned to be handled as usual.
+ * Zero is returned when the key was consumed by the search. */
+static int searchLine(struct linenoiseState *l, char c) {
+    switch(c) {
+    case CTRL_R:
+        l->search_idx++;
+        refreshSearch(l);
+        return 0;
+    case BACKSPACE:
+    case CTRL_H:
+        if (l->search_len) l->search_query[--l->search_len] = '\0';
+        l->search_idx = 0;
+        refreshSearch(l);
+        return 0;
+    case CTRL_G:
+    case CTRL_C:
+        snprintf(l->buf,l->buflen,"%s",l->search_saved ? l->search_saved : "");
+        l->len = l->pos = strlen(l->buf);
+        break;
+    default:
+        if ((unsigned char)c >= 32 && l->search_len < LINENOISE_SEARCH_MAX-1) {
+            l->search_query[l->search_len++] = c;
+            l->search_query[l->search_len] = '\0';
+            l->search_idx = 0;
+            refreshSearch(l);
+            return 0;
+        }
+        break;
+    }
+
+    l->in_search = 0;
+    free(l->search_saved);
+    l->search_saved = NULL;
+    freeSearchMatches(l);
+    refreshLine(l);
+    return (c == CTRL_G || c == CTRL_C) ? 0 : c;
+}
+
 /* This function is used by the callback function registered by the user
  * in order to add completion options given the input string when the
  * user typed <tab>. See the example.c source code for a very easy to
@@ -508,7 +617,7 @@ static void abFree(struct abuf *ab) {
  * to the right of the prompt. */
 void refreshShowHints(struct abuf *ab, struct linenoiseState *l, int plen) {
     char seq[64];
-    if (hintsCallback && plen+l->len < l->cols) {
+    if (hintsCallback && !l->in_search && plen+l->len < l->cols) {
         int color = -1, bold = 0;
         char *hint = hintsCallback(l->buf,&color,&bold);
         if (hint) {
@@ -530,6 +639,27 @@ void refreshShowHints(struct abuf *ab, struct linenoiseState *l, int plen) {
     }
 }
 
+/* Helper of refreshMultiLine() to list the search matches below the line,
+ * one per row, cut to the width of the terminal. The page of
+ * LINENOISE_SEARCH_LIST matches holding the selected one is listed, and
+ * the selected one is marked. Returns the number of rows written. */
+static int refreshSearchList(struct abuf *ab, struct linenoiseState *l) {
+    size_t first = l->search_idx / LINENOISE_SEARCH_LIST * LINENOISE_SEARCH_LIST;
+    size_t width = l->cols > 3 ? l->cols - 3 : 0;
+    int rows = 0;
+
+    for (size_t i = first; i < l->search_matches.len && i < first+LINENOISE_SEARCH_LIST; i++) {
+        const char *match = l->search_matches.cvec[i];
+        size_t len = strlen(match);
+        if (len > width) len = width;
+        abAppend(ab,"\r\n\x1b[0K",6);
+        abAppend(ab,i == l->search_idx ? "> " : "  ",2);
+        abAppend(ab,match,len);
+        rows++;
+    }
+    return rows;
+}
+
 /* Single line low level line refresh.
  *
  * Rewrite the currently edited line accordingly to the buffer content,
@@ -539,7 +669,8 @@ void refreshShowHints(struct abuf *ab, struct linenoiseState *l, int plen) {
  * prompt, just write it, or both. */
 static void refreshSingleLine(struct linenoiseState *l, int flags) {
     char seq[64];
-    size_t plen = strlen(l->prompt);
+    const char *prompt = l->in_search ? l->search_prompt : l->prompt;
+    size_t plen = strlen(prompt);
     int fd = l->ofd;
     char *buf = l->buf;
     size_t len = l->len;
@@ -562,7 +693,7 @@ static void refreshSingleLine(struct linenoiseState *l, int flags) {
 
     if (flags & REFRESH_WRITE) {
         /* Write the prompt and the current buffer content */
-        abAppend(&ab,l->prompt,strlen(l->prompt));
+        abAppend(&ab,prompt,plen);
         if (maskmode == 1) {
             while (len--) abAppend(&ab,"*",1);
         } else {
@@ -595,7 +726,8 @@ static void refreshSingleLine(struct linenoiseState *l, int flags) {
  * prompt, just write it, or both. */
 static void refreshMultiLine(struct linenoiseState *l, int flags) {
     char seq[64];
-    int plen = strlen(l->prompt);
+    const char *prompt = l->in_search ? l->search_prompt : l->prompt;
+    int plen = strlen(prompt);
     int rows = (plen+l->len+l->cols-1)/l->cols; /* rows used by current buf. */
     int rpos = (plen+l->oldpos+l->cols)/l->cols; /* cursor relative row. */
     int rpos2; /* rpos after refresh. */
@@ -634,7 +766,7 @@ static void refreshMultiLine(struct linenoiseState *l, int flags) {
 
     if (flags & REFRESH_WRITE) {
         /* Write the prompt and the current buffer content */
-        abAppend(&ab,l->prompt,strlen(l->prompt));
+        abAppend(&ab,prompt,plen);
         if (maskmode == 1) {
             unsigned int i;
             for (i = 0; i < l->len; i++) abAppend(&ab,"*",1);
@@ -659,6 +791,12 @@ static void refreshMultiLine(struct linenoiseState *l, int flags) {
             if (rows > (int)l->oldrows) l->oldrows = rows;
         }
 
+        /* List the best search matches on the rows below. */
+        if (l->in_search) {
+            rows += refreshSearchList(&ab,l);
+            if (rows > (int)l->oldrows) l->oldrows = rows;
+        }
+
         /* Move cursor to right position. */
         rpos2 = (plen+l->pos+l->cols)/l->cols; /* Current cursor relative row */
         lndebug("rpos2 %d", rpos2);
@@ -788,8 +926,9 @@ void linenoiseEditHistoryNext(struct linenoiseState *l, int dir) {
     if (history_len > 1) {
         /* Update the current history entry before to
          * overwrite it with the next one. */
-        free(history[history_len - 1 - l->history_index]);
-        history[history_len - 1 - l->history_index] = strdup(l->buf);
+        char **slot = historySlot(history_len - 1 - l->history_index);
+        historyFree(*slot);
+        *slot = strdup(l->buf);
         /* Show the new entry */
         l->history_index += (dir == LINENOISE_HISTORY_PREV) ? 1 : -1;
         if (l->history_index < 0) {
@@ -799,7 +938,7 @@ void linenoiseEditHistoryNext(struct linenoiseState *l, int dir) {
             l->history_index = history_len-1;
             return;
         }
-        strncpy(l->buf,history[history_len - 1 - l->history_index],l->buflen);
+        strncpy(l->buf,*historySlot(history_len - 1 - l->history_index),l->buflen);
         l->buf[l->buflen-1] = '\0';
         l->len = l->pos = strlen(l->buf);
         refreshLine(l);
@@ -872,6 +1011,10 @@ int linenoiseEditStart(struct linenoiseState *l, int stdin_fd, int stdout_fd, ch
     /* Populate the linenoise state that we pass to functions implementing
      * specific editing functionalities. */
     l->in_completion = 0;
+    l->in_search = 0;
+    l->search_saved = NULL;
+    l->search_matches.len = 0;
+    l->search_matches.cvec = NULL;
     l->ifd = stdin_fd != -1 ? stdin_fd : STDIN_FILENO;
     l->ofd = stdout_fd != -1 ? stdout_fd : STDOUT_FILENO;
     l->buf = buf;
@@ -937,6 +1080,13 @@ char *linenoiseEditFeed(struct linenoiseState *l) {
     nread = read(l->ifd,&c,1);
     if (nread <= 0) return NULL;
 
+    /* While searching, keys edit the query until one accepts the match,
+     * which is then handled as usual. */
+    if (l->in_search) {
+        c = searchLine(l,c);
+        if (c == 0) return linenoiseEditMore;
+    }
+
     /* Only autocomplete when the callback is set. It returns < 0 when
      * there was an error reading from fd. Otherwise it will return the
      * character that should be handled next. */
@@ -951,7 +1101,7 @@ char *linenoiseEditFeed(struct linenoiseState *l) {
     switch(c) {
     case ENTER:    /* enter */
         history_len--;
-        free(history[history_len]);
+        historyFree(*historySlot(history_len));
         if (mlmode) linenoiseEditMoveEnd(l);
         if (hintsCallback) {
             /* Force a refresh without hints to leave the previous
@@ -975,7 +1125,7 @@ char *linenoiseEditFeed(struct linenoiseState *l) {
             linenoiseEditDelete(l);
         } else {
             history_len--;
-            free(history[history_len]);
+            historyFree(*historySlot(history_len));
             errno = ENOENT;
             return NULL;
         }
@@ -1001,6 +1151,15 @@ char *linenoiseEditFeed(struct linenoiseState *l) {
     case CTRL_N:    /* ctrl-n */
         linenoiseEditHistoryNext(l, LINENOISE_HISTORY_NEXT);
         break;
+    case CTRL_R:    /* ctrl-r, incremental history search */
+        if (searchCallback == NULL) break;
+        l->in_search = 1;
+        l->search_idx = 0;
+        l->search_len = 0;
+        l->search_query[0] = '\0';
+        l->search_saved = strdup(l->buf);
+        refreshSearch(l);
+        break;
     case ESC:    /* escape sequence */
         /* Read the next two bytes representing the escape sequence.
          * Use two calls to handle slow terminals returning the two
@@ -1091,6 +1250,10 @@ char *linenoiseEditFeed(struct linenoiseState *l) {
  * returns something different than NULL. At this point the user input
  * is in the buffer, and we can restore the terminal in normal mode. */
 void linenoiseEditStop(struct linenoiseState *l) {
+    free(l->search_saved);
+    l->search_saved = NULL;
+    l->in_search = 0;
+    freeSearchMatches(l);
     if (!isatty(l->ifd)) return;
     disableRawMode(l->ifd);
     printf("\n");
@@ -1229,7 +1392,7 @@ static void freeHistory(void) {
         int j;
 
         for (j = 0; j < history_len; j++)
-            free(history[j]);
+            historyFree(*historySlot(j));
         free(history);
     }
 }
@@ -1240,13 +1403,32 @@ static void linenoiseAtExit(void) {
     freeHistory();
 }
 
+/* Register memory, such as a mapped history file, whose lines can be added
+ * to the history without a copy. linenoiseHistoryAdd() stores a line that
+ * points into it as is, and never frees it, so the memory must stay valid
+ * as long as the history is used. */
+void linenoiseHistorySetStatic(const char *start, size_t len) {
+    history_static = start;
+    history_static_len = len;
+}
+
+/* Register a callback function to be called for every entry dropped from
+ * the history because it is full. The dropped entry is always the oldest one,
+ * its text is not passed since editing the history may have changed it. */
+void linenoiseSetHistoryEvictCallback(linenoiseHistoryEvictCallback *fn) {
+    historyEvictCallback = fn;
+}
+
+/* Drop an entry that no longer fits in the history. */
+static void historyEvict(char *entry) {
+    if (historyEvictCallback) historyEvictCallback();
+    historyFree(entry);
+}
+
 /* This is the API call to add a new entry in the linenoise history.
- * It uses a fixed array of char pointers that are shifted (memmoved)
- * when the history max length is reached in order to remove the older
- * entry and make room for the new one, so it is not exactly suitable for huge
- * histories, but will work well for a few hundred of entries.
- *
- * Using a circular buffer is smarter, but a bit more complex to handle. */
+ * The history is a ring buffer of char pointers: when the history max length
+ * is reached the oldest entry is freed and its slot is reused for the new
+ * one, so adding an entry costs O(1) regardless of the history size. */
 int linenoiseHistoryAdd(const char *line) {
     char *linecopy;
 
@@ -1257,21 +1439,26 @@ int linenoiseHistoryAdd(const char *line) {
         history = malloc(sizeof(char*)*history_max_len);
         if (history == NULL) return 0;
         memset(history,0,(sizeof(char*)*history_max_len));
+        history_start = 0;
     }
 
     /* Don't add duplicated lines. */
-    if (history_len && !strcmp(history[history_len-1], line)) return 0;
+    if (history_len && !strcmp(*historySlot(history_len-1), line)) return 0;
 
-    /* Add an heap allocated copy of the line in the history.
+    /* Add an heap allocated copy of the line in the history, or the line
+     * itself if it is in the static memory.
      * If we reached the max length, remove the older line. */
-    linecopy = strdup(line);
+    if (line >= history_static && line < history_static+history_static_len)
+        linecopy = (char*)line;
+    else
+        linecopy = strdup(line);
     if (!linecopy) return 0;
     if (history_len == history_max_len) {
-        free(history[0]);
-        memmove(history,history+1,sizeof(char*)*(history_max_len-1));
+        historyEvict(*historySlot(0));
+        history_start = (history_start+1) % history_max_len;
         history_len--;
     }
-    history[history_len] = linecopy;
+    *historySlot(history_len) = linecopy;
     history_len++;
     return 1;
 }
@@ -1279,28 +1466,31 @@ int linenoiseHistoryAdd(const char *line) {
 /* Set the maximum length for the history. This function can be called even
  * if there is already some history, the function will make sure to retain
  * just the latest 'len' elements if the new history length value is smaller
- * than the amount of items already inside the history. */
+ * than the amount of items already inside the history. The retained entries
+ * are unrolled so that the oldest one starts at the first slot. */
 int linenoiseHistorySetMaxLen(int len) {
     char **new;
 
     if (len < 1) return 0;
+    if (len == history_max_len) return 1;
     if (history) {
         int tocopy = history_len;
+        int j;
 
         new = malloc(sizeof(char*)*len);
         if (new == NULL) return 0;
 
         /* If we can't copy everything, free the elements we'll not use. */
         if (len < tocopy) {
-            int j;
-
-            for (j = 0; j < tocopy-len; j++) free(history[j]);
+            for (j = 0; j < tocopy-len; j++) historyEvict(*historySlot(j));
             tocopy = len;
         }
         memset(new,0,sizeof(char*)*len);
-        memcpy(new,history+(history_len-tocopy), sizeof(char*)*tocopy);
+        for (j = 0; j < tocopy; j++)
+            new[j] = *historySlot(history_len-tocopy+j);
         free(history);
         history = new;
+        history_start = 0;
     }
     history_max_len = len;
     if (history_len > history_max_len)
@@ -1308,20 +1498,90 @@ int linenoiseHistorySetMaxLen(int len) {
     return 1;
 }
 
+/* Return the number of entries currently stored in the history. */
+int linenoiseHistoryLength(void) {
+    return history_len;
+}
+
+/* Return the history entry at 'index', where 0 is the oldest entry, or
+ * NULL if the index is out of range. The returned string is owned by
+ * linenoise and is only valid until the history is modified. */
+const char *linenoiseHistoryGet(int index) {
+    if (index < 0 || index >= history_len) return NULL;
+    return *historySlot(index);
+}
+
 /* Save the history in the specified file. On success 0 is returned
- * otherwise -1 is returned. */
+ * otherwise -1 is returned.
+ *
+ * The history is written to a temporary file that is then renamed over
+ * the target, so a crash while saving never leaves a truncated file. */
 int linenoiseHistorySave(const char *filename) {
     mode_t old_umask = umask(S_IXUSR|S_IRWXG|S_IRWXO);
+    size_t tmplen = strlen(filename)+5;
+    char *tmpname = malloc(tmplen);
     FILE *fp;
     int j;
 
-    fp = fopen(filename,"w");
+    if (tmpname == NULL) {
+        umask(old_umask);
+        return -1;
+    }
+    snprintf(tmpname,tmplen,"%s.tmp",filename);
+    fp = fopen(tmpname,"w");
     umask(old_umask);
-    if (fp == NULL) return -1;
-    chmod(filename,S_IRUSR|S_IWUSR);
+    if (fp == NULL) {
+        free(tmpname);
+        return -1;
+    }
+    chmod(tmpname,S_IRUSR|S_IWUSR);
     for (j = 0; j < history_len; j++)
-        fprintf(fp,"%s\n",history[j]);
+        fprintf(fp,"%s\n",*historySlot(j));
+    if (fflush(fp) != 0 || fsync(fileno(fp)) == -1) {
+        fclose(fp);
+        unlink(tmpname);
+        free(tmpname);
+        return -1;
+    }
     fclose(fp);
+    if (rename(tmpname,filename) == -1) {
+        unlink(tmpname);
+        free(tmpname);
+        return -1;
+    }
+    free(tmpname);
+    history_file_lines = history_len;
+    return 0;
+}
+
+/* Append a single line to the specified history file with one write(),
+ * instead of rewriting the whole history. The file works as a log: once it
+ * holds more than LINENOISE_HISTORY_COMPACT_FACTOR times the history max
+ * length lines, it is compacted to the in memory history with
+ * linenoiseHistorySave(). On success 0 is returned otherwise -1 is
+ * returned. */
+int linenoiseHistoryAppend(const char *filename, const char *line) {
+    mode_t old_umask = umask(S_IXUSR|S_IRWXG|S_IRWXO);
+    int fd = open(filename,O_WRONLY|O_CREAT|O_APPEND,S_IRUSR|S_IWUSR);
+    umask(old_umask);
+    if (fd == -1) return -1;
+
+    size_t len = strlen(line);
+    char *entry = malloc(len+1);
+    if (entry == NULL) {
+        close(fd);
+        return -1;
+    }
+    memcpy(entry,line,len);
+    entry[len] = '\n';
+    ssize_t nwritten = write(fd,entry,len+1);
+    free(entry);
+    close(fd);
+    if (nwritten != (ssize_t)(len+1)) return -1;
+
+    history_file_lines++;
+    if (history_file_lines > history_max_len*LINENOISE_HISTORY_COMPACT_FACTOR)
+        return linenoiseHistorySave(filename);
     return 0;
 }
 
@@ -1336,9 +1596,12 @@ int linenoiseHistoryLoad(const char *filename) {
 
     if (fp == NULL) return -1;
 
+    history_file_lines = 0;
     while (fgets(buf,LINENOISE_MAX_LINE,fp) != NULL) {
         char *p;
 
+        history_file_lines++;
+
         p = strchr(buf,'\r');
         if (!p) p = strchr(buf,'\n');
         if (p) *p = '\0';
@@ -47,6 +47,14 @@ extern "C" {
 
 extern char *linenoiseEditMore;
 
+#define LINENOISE_SEARCH_MAX 256 /* Maximum length of a Ctrl-R search query. */
+#define LINENOISE_SEARCH_LIST 5  /* Ranked matches listed below the line while searching. */
+
+typedef struct linenoiseCompletions {
+  size_t len;
+  char **cvec;
+} linenoiseCompletions;
+
 /* The linenoiseState structure represents the state during line editing.
  * We pass this state to functions implementing specific editing
  * functionalities. */
@@ -66,13 +74,16 @@ struct linenoiseState {
     size_t cols;        /* Number of columns in terminal. */
     size_t oldrows;     /* Rows used by last refrehsed line (multiline mode) */
     int history_index;  /* The history index we are currently editing. */
+    int in_search;      /* The user pressed Ctrl-R and we are now in search
+                         * mode, so input is handled by searchLine(). */
+    size_t search_idx;  /* Index of the selected match. */
+    size_t search_len;  /* Length of the search query. */
+    char *search_saved; /* The line as it was before the search. */
+    char search_query[LINENOISE_SEARCH_MAX]; /* The search query. */
+    char search_prompt[LINENOISE_SEARCH_MAX+64]; /* Prompt shown while searching. */
+    linenoiseCompletions search_matches; /* The matches of the query, best first. */
 };
 
-typedef struct linenoiseCompletions {
-  size_t len;
-  char **cvec;
-} linenoiseCompletions;
-
 /* Non blocking API. */
 int linenoiseEditStart(struct linenoiseState *l, int stdin_fd, int stdout_fd, char *buf, size_t buflen, const char *prompt);
 char *linenoiseEditFeed(struct linenoiseState *l);
@@ -88,16 +99,24 @@ void linenoiseFree(void *ptr);
 typedef void(linenoiseCompletionCallback)(const char *, linenoiseCompletions *);
 typedef char*(linenoiseHintsCallback)(const char *, int *color, int *bold);
 typedef void(linenoiseFreeHintsCallback)(void *);
+typedef void(linenoiseSearchCallback)(const char *, linenoiseCompletions *);
+typedef void(linenoiseHistoryEvictCallback)(void);
 void linenoiseSetCompletionCallback(linenoiseCompletionCallback *);
 void linenoiseSetHintsCallback(linenoiseHintsCallback *);
 void linenoiseSetFreeHintsCallback(linenoiseFreeHintsCallback *);
+void linenoiseSetSearchCallback(linenoiseSearchCallback *);
 void linenoiseAddCompletion(linenoiseCompletions *, const char *);
 
 /* History API. */
 int linenoiseHistoryAdd(const char *line);
+void linenoiseHistorySetStatic(const char *start, size_t len);
+void linenoiseSetHistoryEvictCallback(linenoiseHistoryEvictCallback *);
 int linenoiseHistorySetMaxLen(int len);
 int linenoiseHistorySave(const char *filename);
+int linenoiseHistoryAppend(const char *filename, const char *line);
 int linenoiseHistoryLoad(const char *filename);
+int linenoiseHistoryLength(void);
+const char *linenoiseHistoryGet(int index);
 
 /* Other utilities. */
 void linenoiseClearScreen(void);
@@ -5,9 +5,13 @@
    @brief        DSH (Dash Shell - Minimal Shell)
  *******************************************************************************/
 
+#define _GNU_SOURCE
+
 // Library Imports
 #include <sys/wait.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -19,9 +23,25 @@
 #include <unistd.h>
 #include <signal.h>
 #include <ctype.h>
+#include <errno.h>
+#include <spawn.h>
+#include <poll.h>
 #include "linenoise.h"
 #include "utils.h"
 #include "types.h"
+#include "git.h"
+#include "history.h"
+#include "pathhash.h"
+#include "builtins.h"
+#include "scriptcache.h"
+#include "copy.h"
+#include "jobs.h"
+#include "profile.h"
+#include "segment.h"
+#include "cmdindex.h"
+#include "dircache.h"
+#include "fuzzy.h"
+#include "histfile.h"
 
 // App Macros
 #define MAX_BUFFER_SIZE 4096
@@ -29,14 +49,51 @@
 #define MAX_ARGS 64
 #define HISTORY_FILE ".dsh_history"
 #define RC_FILE ".dshrc"
+#define PIPE_BUFFER_SIZE_PREFIX "PIPE_BUFFER_SIZE="
+#define PIPE_MAX_SIZE_FILE "/proc/sys/fs/pipe-max-size"
+#define PARALLEL_SEPARATOR ":::"
+#define PARALLEL_PLACEHOLDER "{}"
+#define PARALLEL_MAX_FAILED 101 // exit status cap, as in GNU parallel
+
+extern char **environ;
+
+// The app whose current directory paths are completed from, the completion callback takes no app
+static app_t *completion_app = NULL;
 
 // Parsing utils
 void parse_tokens(app_t *app);
-char *print_prompt(app_t *app);
-void read_input(app_t *app);
+Command *build_commands(app_t *app, Token *tokens, size_t token_count, bool expand);
+char *print_prompt(app_t *app, const char *branch);
+bool read_input(app_t *app);
+bool history_is_binary(app_t *app);
+char *read_line(app_t *app, char **prompt, const char *branch);
+void execute_line(app_t *app);
+char *expand_tilde(app_t *app, char *line);
+int run_lines(app_t *app, char *text, size_t length);
+int run_script(app_t *app, const char *path);
+int compile_script(app_t *app, const char *path, const struct stat *st, char *text, size_t length);
+int run_cached_script(app_t *app, script_cache_t *cache);
+int run_command_string(app_t *app, const char *commands);
 void prep_args(char *input, char **args);
 void exec_handler(app_t *app);
-void get_args(Token *token, char ***args, int *args_length, app_t *app);
+Command *run_pipeline(app_t *app, Command *command);
+Command *skip_pipeline(Command *command);
+bool is_background(Command *command);
+char *format_pipeline(Command *command, Command *end);
+void wait_foreground(app_t *app, job_t *job);
+Command *collect_redirects(Command *command, redirects_t *redirects);
+pid_t launch_process(app_t *app, Command *command, redirects_t *redirects, stage_t *stage);
+pid_t spawn_process(Command *command, const char *executable, redirects_t *redirects, stage_t *stage);
+pid_t fork_process(Command *command, const char *executable, redirects_t *redirects, stage_t *stage);
+pid_t fork_builtin(app_t *app, const builtin_t *builtin, Command *command, redirects_t *redirects, stage_t *stage);
+void run_builtin(app_t *app, const builtin_t *builtin, Command *command, redirects_t *redirects);
+bool is_copy_command(Command *command, redirects_t *redirects);
+void run_copy(app_t *app, Command *command, redirects_t *redirects);
+bool get_args(Token *tokens, size_t token_count, char ***args, int *args_length, app_t *app, bool expand);
+char *expand_word(app_t *app, char *value);
+char *expand_status(app_t *app, char *value);
+void expand_pipeline_status(app_t *app, Command *command);
+bool expand_commands(app_t *app, Command *command);
 void print_commands(Command *command);
 void completion(const char *buf, linenoiseCompletions *lc);
 char *hints(const char *buf, int *color, int *bold);
@@ -46,10 +103,11 @@ void print_config(config_t *config);
 void free_buffer(buff_t *buffer);
 void free_app(app_t *app);
 void free_cmd_buffer(cmdBuffer_t *buffer);
-void free_commands(Command **command);
+void reset_buffer(buff_t *buffer);
 
 // Built-in commands (No system binaries)
-void change_dir(char *path);
+const builtin_t *find_builtin(const char *name);
+int change_dir(char *path);
 void print_help();
 void print_history();
 
@@ -63,42 +121,441 @@ int main(int argc, char const *argv[])
 
     // Set shell configurations
     load_config(RC_FILE, app->config);
+
+    // Children are reaped as soon as they exit
+    jobs_init();
+
+    // Profiling, "--profile FILE [--profile-format jsonl|chrome]" or PROFILE_FILE in the rc file
+    const char *profile_file = app->config->profileFile;
+    const char *profile_format = app->config->profileFormat;
+    int arg = 1;
+    while (arg < argc && (strcmp(argv[arg], "--profile") == 0 || strcmp(argv[arg], "--profile-format") == 0))
+    {
+        if (arg + 1 >= argc)
+        {
+            fprintf(stderr, "dsh: %s: option requires an argument\n", argv[arg]);
+            exit(2);
+        }
+
+        if (strcmp(argv[arg], "--profile") == 0)
+        {
+            profile_file = argv[arg + 1];
+        }
+        else
+        {
+            profile_format = argv[arg + 1];
+        }
+        arg += 2;
+    }
+
+    if (profile_file != NULL)
+    {
+        profile_open(profile_file, profile_format);
+    }
+
+    // Batch mode, "dsh script.sh" or "dsh -c 'commands'": no prompt, no history
+    if (arg < argc)
+    {
+        int status;
+
+        if (strcmp(argv[arg], "-c") == 0)
+        {
+            if (arg + 1 >= argc)
+            {
+                fprintf(stderr, "dsh: -c: option requires an argument\n");
+                exit(2);
+            }
+            status = run_command_string(app, argv[arg + 1]);
+        }
+        else
+        {
+            status = run_script(app, argv[arg]);
+        }
+
+        free_app(app);
+        return status;
+    }
+
+    // On a terminal the shell runs in its own process group and hands the terminal to foreground jobs
+    app->interactive = isatty(STDIN_FILENO);
+    if (app->interactive)
+    {
+        signal(SIGQUIT, SIG_IGN);
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGTTIN, SIG_IGN);
+        signal(SIGTTOU, SIG_IGN);
+        setpgid(0, 0);
+        app->shell_pgid = getpgrp();
+        tcsetpgrp(STDIN_FILENO, app->shell_pgid);
+    }
+
     linenoiseSetMultiLine(1);
     if (app->config->tabCompletion)
     {
+        completion_app = app;
         linenoiseSetCompletionCallback(completion);
         linenoiseSetHintsCallback(hints);
+        linenoiseSetSearchCallback(fuzzy_index_search);
+        linenoiseSetHistoryEvictCallback(history_index_evict);
+    }
+    const char *history_path = app->config->historyFile != NULL ? app->config->historyFile : HISTORY_FILE;
+    int history_size = app->config->historySize != 0 ? app->config->historySize : MAX_HISTORY_SIZE;
+    linenoiseHistorySetMaxLen(history_size);
+    if (history_is_binary(app))
+    {
+        // Lines are appended to the text history when the binary one cannot be used
+        if (history_file_load(history_path, history_size) == 1)
+        {
+            free(app->config->historyFormat);
+            app->config->historyFormat = strdup("text");
+        }
+    }
+    else
+    {
+        linenoiseHistoryLoad(history_path);
+    }
+    if (app->config->tabCompletion)
+    {
+        history_index_load(history_path);
+    }
+
+    // App Loop, until end of input
+    while (true)
+    {
+        // Report background jobs that finished or stopped since the last prompt
+        jobs_block();
+        jobs_notify(true);
+        jobs_unblock();
+
+        if (!read_input(app))
+        {
+            break;
+        }
+        execute_line(app);
+        history_file_finish(app->last_status);
+    }
+
+    int status = app->last_status;
+    free_app(app);
+    return status;
+}
+
+/**
+ * Tokenizes, parses and executes the line held in the app buffer, then releases it.
+ *
+ * @param app The app object containing the line.
+ */
+void execute_line(app_t *app)
+{
+    profile_line_begin(app->app_buffer->buffer);
+
+    uint64_t started = profile_start();
+    app->app_buffer->token_count = tokenize(app->app_buffer->buffer, &app->app_buffer->tokens, app->app_buffer->arena);
+    profile_record(PROFILE_TOKENIZE, started);
+
+    started = profile_start();
+    parse_tokens(app);
+    profile_record(PROFILE_PARSE, started);
+
+    exec_handler(app);
+    profile_line_end();
+
+    // Release the line, its tokens and its commands in one step
+    reset_buffer(app->app_buffer);
+}
+
+/**
+ * Replaces every "~" of a line with the home directory.
+ *
+ * @param app The app object, the expanded line is allocated from its buffer's arena.
+ * @param line The line to be expanded.
+ * @return The expanded line, or the line itself if it has nothing to expand.
+ */
+char *expand_tilde(app_t *app, char *line)
+{
+    char *home_dir = getenv("HOME");
+    if (home_dir == NULL || strchr(line, '~') == NULL)
+    {
+        return line;
+    }
+
+    size_t tildes = 0;
+    for (char *p = line; *p != '\0'; p++)
+    {
+        tildes += *p == '~';
+    }
+
+    size_t home_length = strlen(home_dir);
+    char *expanded = arena_alloc(app->app_buffer->arena, strlen(line) + tildes * home_length + 1);
+    char *out = expanded;
+
+    for (char *p = line; *p != '\0'; p++)
+    {
+        if (*p == '~')
+        {
+            memcpy(out, home_dir, home_length);
+            out += home_length;
+        }
+        else
+        {
+            *out++ = *p;
+        }
+    }
+    *out = '\0';
+
+    return expanded;
+}
+
+/**
+ * Splits the next line off a block of script text.
+ *
+ * @param app The app object, copied lines are allocated from its buffer's arena.
+ * @param cursor The start of the line, advanced past it.
+ * @param end The end of the text.
+ * @param in_place Whether the line may be terminated in place, otherwise it is copied.
+ * @return The line without leading blanks, or NULL for a blank line or a "#" comment.
+ */
+static char *next_script_line(app_t *app, char **cursor, char *end, bool in_place)
+{
+    char *line = *cursor;
+    char *newline = memchr(line, '\n', end - line);
+    size_t line_length = newline != NULL ? (size_t)(newline - line) : (size_t)(end - line);
+
+    *cursor += line_length + 1;
+
+    char *buffer;
+    if (in_place && newline != NULL)
+    {
+        *newline = '\0';
+        buffer = line;
+    }
+    else
+    {
+        // The last line is not terminated, and the text may end exactly at a page boundary
+        buffer = arena_alloc(app->app_buffer->arena, line_length + 1);
+        memcpy(buffer, line, line_length);
+        buffer[line_length] = '\0';
     }
-    linenoiseHistoryLoad(app->config->historyFile != NULL ? app->config->historyFile : HISTORY_FILE);
-    linenoiseHistorySetMaxLen(app->config->historySize != 0 ? app->config->historySize : MAX_HISTORY_SIZE);
 
-    // App Loop
-    do
+    char *start = buffer + strspn(buffer, " \t\r");
+    return *start == '\0' || *start == '#' ? NULL : start;
+}
+
+/**
+ * Removes the background jobs of a script that finished, without reporting them.
+ */
+static void forget_finished_jobs(void)
+{
+    jobs_block();
+    jobs_notify(false);
+    jobs_unblock();
+}
+
+/**
+ * Executes a block of script text line by line. Lines are split in place, so the text
+ * must be writable. Blank lines and "#" comments are skipped.
+ *
+ * @param app The app object.
+ * @param text The script text.
+ * @param length The length of the text.
+ * @return The exit status of the last command.
+ */
+int run_lines(app_t *app, char *text, size_t length)
+{
+    char *end = text + length;
+    char *cursor = text;
+
+    while (cursor < end)
     {
-        read_input(app);
-        tokenize(app->app_buffer->buffer, &app->app_buffer->token_list);
+        char *line = next_script_line(app, &cursor, end, true);
+        if (line == NULL)
+        {
+            reset_buffer(app->app_buffer);
+            continue;
+        }
 
-        linenoiseFree(app->app_buffer->buffer);
-        app->app_buffer->buffer = NULL;
-        app->app_buffer->buffer_length = 0;
+        app->app_buffer->buffer = expand_tilde(app, line);
+        app->app_buffer->buffer_length = strlen(app->app_buffer->buffer);
+        execute_line(app);
+        forget_finished_jobs();
+    }
+
+    return app->last_status;
+}
 
-        parse_tokens(app);
-        free(app->app_buffer->token_list);
-        app->app_buffer->token_list = NULL;
+/**
+ * Parses a script and writes its Command chains to the script's cache file. The text
+ * is left untouched, every line is parsed from a copy.
+ *
+ * @param app The app object.
+ * @param path The path of the script.
+ * @param st The status of the script.
+ * @param text The script text.
+ * @param length The length of the text.
+ * @return 0 on success, -1 if the cache could not be written.
+ */
+int compile_script(app_t *app, const char *path, const struct stat *st, char *text, size_t length)
+{
+    script_cache_writer_t *writer = script_cache_create(path, st);
+    if (writer == NULL)
+    {
+        return -1;
+    }
 
-        exec_handler(app);
+    buff_t *buffer = app->app_buffer;
+    char *end = text + length;
+    char *cursor = text;
 
-        if (app->app_buffer->command_list != NULL)
+    while (cursor < end)
+    {
+        char *line = next_script_line(app, &cursor, end, false);
+        if (line != NULL)
         {
-            free_commands(&(app->app_buffer->command_list[0]));
+            buffer->buffer = line;
+            buffer->token_count = tokenize(line, &buffer->tokens, buffer->arena);
+            Command *first = build_commands(app, buffer->tokens, buffer->token_count, false);
+            if (first != NULL && script_cache_write_line(writer, first) != 0)
+            {
+                // A cache missing lines must never be used
+                reset_buffer(buffer);
+                script_cache_abort(writer);
+                return -1;
+            }
         }
 
-    } while (1);
+        reset_buffer(buffer);
+    }
 
-    // free line after use
-    linenoiseFree(app->app_buffer->buffer);
-    free_buffer(app->app_buffer);
-    free_app(app);
+    return script_cache_finish(writer);
+}
+
+/**
+ * Executes a script from its cache file. Only variable and tilde expansion is done per line,
+ * tokenizing and parsing were done when the cache was written.
+ *
+ * @param app The app object.
+ * @param cache The opened cache.
+ * @return The exit status of the last command.
+ */
+int run_cached_script(app_t *app, script_cache_t *cache)
+{
+    Command *first;
+
+    uint64_t started = profile_start();
+
+    while ((first = script_cache_next(cache, app->app_buffer->arena)) != NULL)
+    {
+        // The cached records replace tokenizing and parsing
+        profile_record(PROFILE_PARSE, started);
+        if (profile_enabled())
+        {
+            char *text = format_pipeline(first, NULL);
+            profile_line_begin(text);
+            free(text);
+        }
+
+        if (expand_commands(app, first))
+        {
+            app->app_buffer->command_list[0] = first;
+            exec_handler(app);
+        }
+        profile_line_end();
+        forget_finished_jobs();
+        started = profile_start();
+
+        reset_buffer(app->app_buffer);
+    }
+
+    return app->last_status;
+}
+
+/**
+ * Executes a script file. The file is mapped copy-on-write and split into lines in
+ * place, so it is neither copied nor read a character at a time. When the script cache
+ * is enabled, the parsed script is cached and reused until the script changes.
+ *
+ * @param app The app object.
+ * @param path The path of the script.
+ * @return The exit status of the last command, or 127 if the script cannot be read.
+ */
+int run_script(app_t *app, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "dsh: %s: %s\n", path, strerror(errno));
+        return 127;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        fprintf(stderr, "dsh: %s: %s\n", path, strerror(errno));
+        close(fd);
+        return 127;
+    }
+
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    script_cache_t cache = {0};
+    if (app->config->scriptCache && script_cache_open(&cache, path, &st) == 0)
+    {
+        close(fd);
+        int status = run_cached_script(app, &cache);
+        script_cache_close(&cache);
+        return status;
+    }
+
+    char *text = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (text == MAP_FAILED)
+    {
+        fprintf(stderr, "dsh: %s: %s\n", path, strerror(errno));
+        return 127;
+    }
+
+    madvise(text, st.st_size, MADV_SEQUENTIAL);
+
+    int status;
+    if (app->config->scriptCache && compile_script(app, path, &st, text, st.st_size) == 0 &&
+        script_cache_open(&cache, path, &st) == 0)
+    {
+        status = run_cached_script(app, &cache);
+        script_cache_close(&cache);
+    }
+    else
+    {
+        status = run_lines(app, text, st.st_size);
+    }
+
+    munmap(text, st.st_size);
+    return status;
+}
+
+/**
+ * Executes the commands given with "-c".
+ *
+ * @param app The app object.
+ * @param commands The commands, one or more lines.
+ * @return The exit status of the last command.
+ */
+int run_command_string(app_t *app, const char *commands)
+{
+    char *text = strdup(commands);
+    if (text == NULL)
+    {
+        perror("Error allocating memory for commands");
+        exit(EXIT_FAILURE);
+    }
+
+    int status = run_lines(app, text, strlen(text));
+
+    free(text);
+    return status;
 }
 
 /** *
@@ -172,7 +629,15 @@ int main(int argc, char const *argv[])
 
 //     return prompt;
 // }
-char *print_prompt(app_t *app)
+
+/**
+ * Builds the prompt for the current directory.
+ *
+ * @param app The app object.
+ * @param branch The git branch of the current directory, an empty string outside a repository.
+ * @return The prompt (heap allocated).
+ */
+char *print_prompt(app_t *app, const char *branch)
 {
     char *prompt = (char *)malloc(MAX_BUFFER_SIZE * sizeof(char));
     if (prompt == NULL)
@@ -181,23 +646,8 @@ char *print_prompt(app_t *app)
         exit(EXIT_FAILURE);
     }
 
-    getcwd(app->current_directory, app->current_directory_length);
-
-    FILE *fp = popen("git rev-parse --abbrev-ref HEAD 2>/dev/null", "r");
-    char git_branch[1024] = "";
-
-    if (fp != NULL)
-    {
-        fgets(git_branch, sizeof(git_branch), fp);
-        git_branch[strcspn(git_branch, "\n")] = 0; // remove trailing newline
-        pclose(fp);
-    }
-    else
-    {
-        perror("popen failed");
-        free(prompt); // Free the allocated memory before returning NULL
-        return NULL;
-    }
+    // The dirty state is the last known one, read_line() refreshes it while the prompt is shown
+    const char *dirty = app->config->promptGitStatus && *branch ? segment_dirty(app->current_directory) : "";
 
     // Color escape sequences
     char *green = "\033[0;32m";
@@ -210,339 +660,2184 @@ char *print_prompt(app_t *app)
     // Include "@" symbol only if a user name is available
     char *at = (app->config->promptUser && user && *user) ? "@" : "";
 
-    if (strlen(git_branch) > 0)
+    if (strlen(branch) > 0)
     {
         if (app->config->promptTheme)
         {
-            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s%s%s (git:%s%s%s)%s ", green, user, at, basename(app->current_directory), reset, blue, git_branch, reset, app->config->promptSym);
+            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s%s%s (git:%s%s%s%s)%s ", green, user, at, basename(app->current_directory), reset, blue, branch, dirty, reset, app->config->promptSym);
         }
         else
         {
-            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s (git:%s)%s ", user, at, basename(app->current_directory), git_branch, app->config->promptSym);
+            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s (git:%s%s)%s ", user, at, basename(app->current_directory), branch, dirty, app->config->promptSym);
         }
     }
     else
     {
         if (app->config->promptTheme)
         {
-            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s%s%s ", green, user, at, basename(app->current_directory), reset);
+            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s%s%s ", green, user, at, basename(app->current_directory), reset);
+        }
+        else
+        {
+            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s ", user, at, basename(app->current_directory));
+        }
+    }
+
+    return prompt;
+}
+
+/**
+ * Reads a line with the prompt shown right away. Slow prompt segments are computed in
+ * the background meanwhile; when a result arrives the line is hidden, the prompt rebuilt
+ * and the line shown again, so what was typed so far stays as it is.
+ *
+ * @param app The app object.
+ * @param prompt The prompt, replaced (and freed) when it is rebuilt.
+ * @param branch The git branch the prompt was built with.
+ * @return The line, NULL at the end of input or on Ctrl-C (errno is EAGAIN).
+ */
+char *read_line(app_t *app, char **prompt, const char *branch)
+{
+    int segment_fd = -1;
+    if (app->config->promptGitStatus && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO) && *branch)
+    {
+        segment_fd = segment_start(app->current_directory);
+    }
+
+    // Nothing to wait for, the blocking API does the same with less work
+    if (segment_fd == -1)
+    {
+        return linenoise(*prompt);
+    }
+
+    char buffer[MAX_BUFFER_SIZE];
+    struct linenoiseState state;
+    char *line = linenoiseEditMore;
+
+    if (linenoiseEditStart(&state, -1, -1, buffer, sizeof(buffer), *prompt) == -1)
+    {
+        segment_cancel();
+        return NULL;
+    }
+
+    while (line == linenoiseEditMore)
+    {
+        struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {segment_fd, POLLIN, 0}};
+        if (poll(fds, segment_fd != -1 ? 2 : 1, -1) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue; // SIGCHLD
+            }
+            break;
+        }
+
+        if (segment_fd != -1 && fds[1].revents != 0 && segment_update())
+        {
+            segment_fd = -1;
+
+            char *updated = print_prompt(app, branch);
+            if (strcmp(updated, *prompt) != 0)
+            {
+                linenoiseHide(&state);
+                free(*prompt);
+                *prompt = updated;
+                state.prompt = updated;
+                state.plen = strlen(updated);
+                linenoiseShow(&state);
+            }
+            else
+            {
+                free(updated);
+            }
+        }
+
+        if (fds[0].revents != 0)
+        {
+            line = linenoiseEditFeed(&state);
+        }
+    }
+
+    int saved_errno = errno;
+    segment_cancel();
+    linenoiseEditStop(&state);
+    errno = saved_errno;
+
+    return line != linenoiseEditMore ? line : NULL;
+}
+
+/**
+ * Checks whether the history is kept in the binary format, see histfile.h.
+ *
+ * @param app The app object.
+ * @return true if HISTORY_FORMAT is "binary".
+ */
+bool history_is_binary(app_t *app)
+{
+    return app->config->historyFormat != NULL && strcmp(app->config->historyFormat, "binary") == 0;
+}
+
+/**
+ * Reads user input from the command line and stores it in the application buffer.
+ *
+ * @param app The application structure containing the buffer to store the input.
+ * @return false at the end of input, true otherwise.
+ */
+bool read_input(app_t *app)
+{
+    uint64_t started = profile_start();
+    getcwd(app->current_directory, app->current_directory_length);
+
+    // Resolve the branch natively (cached on HEAD's stat) instead of forking git, once per prompt
+    const char *branch = git_branch(app->current_directory);
+    char *prompt = print_prompt(app, branch);
+    profile_record(PROFILE_PROMPT, started);
+
+    started = profile_start();
+    errno = 0;
+    char *line_read = read_line(app, &prompt, branch);
+    profile_record(PROFILE_READ, started);
+    free(prompt);
+
+    if (line_read == NULL)
+    {
+        // Ctrl-C only discards the line being edited, anything else is the end of input
+        if (errno == EAGAIN)
+        {
+            app->app_buffer->buffer = arena_strdup(app->app_buffer->arena, "");
+            app->app_buffer->buffer_length = 0;
+            return true;
+        }
+        return false;
+    }
+
+    started = profile_start();
+    if (*line_read)
+    {
+        // Every use counts for the ranking of hints, even a repeated line
+        if (app->config->tabCompletion)
+        {
+            history_index_use(line_read);
+        }
+
+        // Only new entries are appended to the history log, linenoise skips repeated lines.
+        // A binary history entry is written once the line has run, with its status.
+        if (linenoiseHistoryAdd(line_read))
+        {
+            if (history_is_binary(app))
+            {
+                history_file_begin(line_read, app->current_directory);
+            }
+            else
+            {
+                linenoiseHistoryAppend(app->config->historyFile ? app->config->historyFile : HISTORY_FILE, line_read);
+            }
+        }
+    }
+    profile_record(PROFILE_HISTORY, started);
+
+    app->app_buffer->buffer = expand_tilde(app, arena_strdup(app->app_buffer->arena, line_read));
+    app->app_buffer->buffer_length = strlen(app->app_buffer->buffer);
+    linenoiseFree(line_read);
+
+    return true;
+}
+
+/**
+ * @brief Command type created for each operator token kind.
+ */
+static const command_t operator_commands[] = {
+    [TOKEN_PIPE] = PIPE,
+    [TOKEN_REDIRECT_IN] = REDIRECT_IN,
+    [TOKEN_REDIRECT_OUT] = REDIRECT_OUT,
+    [TOKEN_REDIRECT_ERR] = REDIRECT_ERR,
+    [TOKEN_REDIRECT_APP] = REDIRECT_APP,
+    [TOKEN_BACKGROUND] = BACKGROUND,
+    [TOKEN_SEQUENCE] = SEQUENCE,
+    [TOKEN_CONDITIONAL] = CONDITIONAL,
+};
+
+/**
+ * Parses the tokens in the app buffer and creates a command list.
+ * Each token is checked for its kind and a corresponding command is created.
+ * The command list is stored in the app buffer.
+ *
+ * @param app The app structure containing the app buffer.
+ */
+void parse_tokens(app_t *app)
+{
+    buff_t *buffer = app->app_buffer;
+    buffer->command_list[0] = build_commands(app, buffer->tokens, buffer->token_count, true);
+}
+
+/**
+ * Builds the Command chain of a tokenized line.
+ *
+ * @param app The app structure containing the app buffer.
+ * @param tokens The tokens of the line.
+ * @param token_count The number of tokens.
+ * @param expand Whether to expand variables in the arguments. The script cache stores
+ *               unexpanded arguments, which are expanded each time the line runs.
+ * @return The first command of the line, or NULL if the line has no tokens or refers to
+ *         something undefined, in which case the status is set to 1.
+ */
+Command *build_commands(app_t *app, Token *tokens, size_t token_count, bool expand)
+{
+    arena_t *arena = app->app_buffer->arena;
+    Command head = {0};
+    Command *last_command = &head;
+
+    size_t t = 0;
+    while (t < token_count)
+    {
+
+        char **args = NULL;
+        int args_length = 0;
+        command_t type;
+
+        // Operators were classified by the tokenizer, so no string comparison is needed here
+        if (tokens[t].kind == TOKEN_WORD)
+        {
+            // The whole line is dropped, none of its commands run
+            if (!get_args(&tokens[t], token_count - t, &args, &args_length, app, expand))
+            {
+                app->last_status = 1;
+                return NULL;
+            }
+            type = SIMPLE;
+        }
+        else
+        {
+            type = operator_commands[tokens[t].kind];
+        }
+
+        last_command->next = new_command(type, args, args_length, arena);
+        last_command = last_command->next;
+
+        t += args_length > 0 ? (size_t)args_length : 1;
+    }
+
+    return head.next;
+}
+
+/**
+ * Expands a single argument: "Editor" and environment variables. "$?" and "$PIPESTATUS"
+ * are left for expand_status(), they change as the pipelines of the line run.
+ *
+ * @param app The app structure containing the app buffer.
+ * @param value The argument.
+ * @return The expanded argument, the argument itself if there is nothing to expand,
+ *         or NULL if it refers to something undefined.
+ */
+char *expand_word(app_t *app, char *value)
+{
+    arena_t *arena = app->app_buffer->arena;
+
+    if (strcmp(value, "Editor") == 0)
+    {
+        // Replace "Editor" with the value of config->editor
+        char *editor_value = app->config->editor;
+        if (editor_value == NULL)
+        {
+            printf("Editor is not set in the configuration\n");
+            return NULL;
+        }
+
+        // Make a copy of the editor value
+        char *editor_value_copy = arena_strdup(arena, editor_value);
+
+        printf("Editor value: %s\n", editor_value_copy);
+        return editor_value_copy;
+    }
+    // Expanded just before their pipeline runs
+    else if (strcmp(value, "$?") == 0 || strcmp(value, "$PIPESTATUS") == 0)
+    {
+        return value;
+    }
+    // Check if the token is an environment variable
+    else if (value[0] == '$')
+    {
+        // Get the value of the environment variable
+        char *env_value = getenv(value + 1);
+        if (env_value == NULL)
+        {
+            printf("Undefined environment variable: %s\n", value);
+            return NULL;
+        }
+
+        // Make a copy of the environment variable value
+        return arena_strdup(arena, env_value);
+    }
+
+    return value;
+}
+
+/**
+ * Expands "$?" and "$PIPESTATUS" to the statuses of the last pipeline that ran.
+ *
+ * @param app The app structure containing the app buffer.
+ * @param value The argument.
+ * @return The expanded argument, or the argument itself if it is neither.
+ */
+char *expand_status(app_t *app, char *value)
+{
+    arena_t *arena = app->app_buffer->arena;
+
+    // Exit status of the last pipeline
+    if (strcmp(value, "$?") == 0)
+    {
+        char *status = arena_alloc(arena, 12);
+        snprintf(status, 12, "%d", app->last_status);
+        return status;
+    }
+    // Exit statuses of every stage of the last pipeline, e.g. "0 1 0"
+    else if (strcmp(value, "$PIPESTATUS") == 0)
+    {
+        char *status = arena_alloc(arena, 12 * (app->pipe_status_length + 1));
+        size_t length = 0;
+        status[0] = '\0';
+        for (int s = 0; s < app->pipe_status_length; s++)
+        {
+            length += sprintf(status + length, s > 0 ? " %d" : "%d", app->pipe_status[s]);
+        }
+        return status;
+    }
+
+    return value;
+}
+
+/**
+ * Expands "$?" and "$PIPESTATUS" in the arguments of a pipeline, so that "false ; echo $?"
+ * sees the status of "false".
+ *
+ * @param app The app structure containing the app buffer.
+ * @param command The first command of the pipeline.
+ */
+void expand_pipeline_status(app_t *app, Command *command)
+{
+    for (; command != NULL; command = command->next)
+    {
+        if (command->type == SEQUENCE || command->type == CONDITIONAL || command->type == BACKGROUND)
+        {
+            return;
+        }
+
+        for (int i = 0; i < command->args_length; i++)
+        {
+            command->args[i] = expand_status(app, command->args[i]);
+        }
+    }
+}
+
+/**
+ * Expands the arguments of a Command chain loaded from the script cache. The cached
+ * arguments are read-only, expanded ones are allocated from the arena.
+ *
+ * @param app The app structure containing the app buffer.
+ * @param command The first command of the line.
+ * @return false if an argument refers to something undefined and the line must not run,
+ *         the status is then set to 1.
+ */
+bool expand_commands(app_t *app, Command *command)
+{
+    for (; command != NULL; command = command->next)
+    {
+        for (int i = 0; i < command->args_length; i++)
+        {
+            char *value = expand_word(app, expand_tilde(app, command->args[i]));
+            if (value == NULL)
+            {
+                app->last_status = 1;
+                return false;
+            }
+            command->args[i] = value;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Extracts arguments from an array of tokens, up to the next operator.
+ * Plain arguments point straight into the tokenized input line.
+ *
+ * @param tokens The first token of the arguments.
+ * @param token_count The number of tokens left in the array.
+ * @param args Pointer to the array of arguments.
+ * @param args_length Pointer to the length of the args array.
+ * @param app The app structure containing the app buffer.
+ * @param expand Whether to expand variables in the arguments.
+ * @return false if an argument refers to something undefined. The arguments expanded
+ *         so far are still terminated and counted.
+ */
+
+bool get_args(Token *tokens, size_t token_count, char ***args, int *args_length, app_t *app, bool expand)
+{
+    arena_t *arena = app->app_buffer->arena;
+    char *input = app->app_buffer->buffer;
+    size_t count = 0;
+    int i = 0;
+
+    // Count the arguments up to the next operator, so args is sized exactly
+    while (count < token_count && tokens[count].kind == TOKEN_WORD)
+    {
+        count++;
+    }
+
+    // Allocate memory for args
+    *args = arena_alloc(arena, sizeof(char *) * (count + 1)); // Allocate an extra element for the NULL pointer
+
+    for (size_t t = 0; t < count; t++)
+    {
+        char *value = input + tokens[t].offset;
+
+        if (expand)
+        {
+            value = expand_word(app, value);
+            if (value == NULL)
+            {
+                break;
+            }
+        }
+
+        (*args)[i] = value;
+        i++;
+    }
+
+    (*args)[i] = NULL; // Add the NULL pointer at the end of the args array
+    *args_length = i;
+    return (size_t)i == count;
+}
+
+/**
+ * Tokenizes the input string and stores the tokens in the args array.
+ * Each token is separated by a space character.
+ * The newline character at the end of each token is removed.
+ *
+ * @param input The input string to be tokenized.
+ * @param args The array to store the tokens.
+ */
+void prep_args(char *input, char **args)
+{
+    char *token = strtok(input, " ");
+    int i = 0;
+    while (token != NULL)
+    {
+        // Remove newline character at the end of each token
+        size_t len = strlen(token);
+        if (token[len - 1] == '\n')
+        {
+            token[len - 1] = '\0';
+        }
+
+        args[i] = token;
+        token = strtok(NULL, " ");
+        i++;
+    }
+    args[i] = NULL;
+}
+
+/**
+ * Changes the current working directory to the specified path.
+ *
+ * @param path The path of the directory to change to.
+ * @return 0 on success, 1 on failure.
+ */
+int change_dir(char *path)
+{
+    if (chdir(path) != 0)
+    {
+        perror("Error changing directory");
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Prints the help information for the shell program.
+ */
+void print_help()
+{
+    printf("DSH (Dash Shell) - A minimal shell\n\n");
+    printf("Built-in Commands:\n");
+    printf("cd [directory] - Change the current working directory to [directory], or to $HOME\n");
+    printf("exit [status] - Terminate the shell process\n");
+    printf("help - Display this help information\n");
+    printf("history [-v | --export FILE] - Display the command history, with -v also when, where and how each line ran (binary history)\n");
+    printf("hash [-r] - Display the remembered command locations, or forget them with -r\n");
+    printf("jobs - List the background and stopped jobs\n");
+    printf("fg [%%n] - Continue a job in the foreground\n");
+    printf("bg [%%n] - Continue a stopped job in the background\n");
+    printf("wait [%%n | pid ...] - Wait for the given jobs, or for every running job\n");
+    printf("parallel [-j N] [-g] [-v] <command> ::: <args> - Run <command> once per argument, N at a time\n");
+    printf("echo [-n] <args> - Print <args>, without a trailing newline with -n\n");
+    printf("pwd - Print the current working directory\n");
+    printf("true / false - Exit with a success / failure status\n");
+    printf("printf <format> <args> - Print <args> according to <format>\n");
+    printf("test <expr> / [ <expr> ] - Evaluate a conditional expression\n");
+    printf("\n");
+
+    printf("Redirection and Piping:\n");
+    printf("<command> > <file> - Redirect the output of <command> to <file>\n");
+    printf("<command> >> <file> - Append the output of <command> to <file>\n");
+    printf("<command> < <file> - Use <file> as the input to <command>\n");
+    printf("<command> 2> <file> - Redirect the error output of <command> to <file>\n");
+    printf("<command1> | <command2> - Pipe the output of <command1> to the input of <command2>\n");
+    printf("\n");
+
+    printf("Background Execution:\n");
+    printf("<command> & - Execute <command> in the background\n");
+    printf("Ctrl-Z - Stop the foreground job, continue it with fg or bg\n");
+    printf("\n");
+
+    printf("RC System:\n");
+    printf("DSH reads a startup file (~/.dshrc) that can contain any shell commands.\n");
+    printf("These commands are executed when the shell starts.\n");
+    printf("This can be used to set environment variables, define aliases, and more.\n");
+    printf("\n");
+}
+
+/**
+ * Prints the command history held in memory by linenoise.
+ */
+void print_history()
+{
+    int length = linenoiseHistoryLength();
+
+    for (int i = 0; i < length; i++)
+    {
+        printf("%s\n", linenoiseHistoryGet(i));
+    }
+}
+
+/**
+ * The "cd" builtin. Without an argument it changes to the home directory.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+static int builtin_cd(app_t *app, char **args)
+{
+    char *path = args[1] != NULL ? args[1] : getenv("HOME");
+    if (path == NULL)
+    {
+        fprintf(stderr, "cd: HOME not set\n");
+        return 1;
+    }
+
+    return change_dir(path);
+}
+
+/**
+ * The "exit" builtin, with an optional exit status.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return Does not return.
+ */
+static int builtin_exit(app_t *app, char **args)
+{
+    exit(args[1] != NULL ? atoi(args[1]) : 0);
+}
+
+/**
+ * The "help" builtin.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+static int builtin_help(app_t *app, char **args)
+{
+    print_help();
+    return 0;
+}
+
+/**
+ * The "history" builtin. With a binary history, "-v" also prints when each line ran,
+ * its exit status, duration and directory, and "--export FILE" writes the history as text.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+static int builtin_history(app_t *app, char **args)
+{
+    if (args[1] == NULL)
+    {
+        print_history();
+        return 0;
+    }
+
+    if (!history_is_binary(app))
+    {
+        fprintf(stderr, "history: %s needs HISTORY_FORMAT = binary\n", args[1]);
+        return 1;
+    }
+
+    if (strcmp(args[1], "-v") == 0)
+    {
+        history_file_list(stdout);
+        return 0;
+    }
+
+    if (strcmp(args[1], "--export") == 0 && args[2] != NULL)
+    {
+        if (history_file_export(args[2]) == -1)
+        {
+            perror("history");
+            return 1;
+        }
+        return 0;
+    }
+
+    fprintf(stderr, "usage: history [-v | --export FILE]\n");
+    return 2;
+}
+
+/**
+ * The "hash" builtin, prints the command hash or resets it with -r.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+static int builtin_hash(app_t *app, char **args)
+{
+    if (args[1] != NULL && strcmp(args[1], "-r") == 0)
+    {
+        path_hash_reset();
+    }
+    else
+    {
+        path_hash_print();
+    }
+
+    return 0;
+}
+
+/**
+ * The "jobs" builtin, lists the jobs with their state, run time and process group.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The exit status.
+ */
+static int builtin_jobs(app_t *app, char **args)
+{
+    jobs_block();
+    jobs_print();
+    jobs_unblock();
+    return 0;
+}
+
+/**
+ * Sends SIGCONT to the processes of a stopped job.
+ *
+ * @param app The app object.
+ * @param job The job.
+ */
+static void continue_job(app_t *app, job_t *job)
+{
+    if (job->state != JOB_STOPPED)
+    {
+        return;
+    }
+
+    if (app->interactive)
+    {
+        kill(-job->pgid, SIGCONT);
+    }
+    else
+    {
+        for (int i = 0; i < job->stage_count; i++)
+        {
+            if (job->pids[i] > 0 && job->statuses[i] == -1)
+            {
+                kill(job->pids[i], SIGCONT);
+            }
+        }
+    }
+
+    job->state = JOB_RUNNING;
+}
+
+/**
+ * The "fg" builtin, continues a job in the foreground and waits for it.
+ *
+ * @param app The app object.
+ * @param args The command's arguments, optionally a job specification.
+ * @return The exit status of the job.
+ */
+static int builtin_fg(app_t *app, char **args)
+{
+    jobs_block();
+
+    job_t *job = jobs_find(args[1]);
+    if (job == NULL)
+    {
+        jobs_unblock();
+        fprintf(stderr, "fg: %s: no such job\n", args[1] != NULL ? args[1] : "current");
+        return 1;
+    }
+
+    printf("%s\n", job->command);
+    fflush(stdout);
+
+    job->background = false;
+    continue_job(app, job);
+    wait_foreground(app, job);
+
+    jobs_unblock();
+    return app->last_status;
+}
+
+/**
+ * The "bg" builtin, continues a stopped job in the background.
+ *
+ * @param app The app object.
+ * @param args The command's arguments, optionally a job specification.
+ * @return The exit status.
+ */
+static int builtin_bg(app_t *app, char **args)
+{
+    jobs_block();
+
+    job_t *job = jobs_find(args[1]);
+    if (job == NULL)
+    {
+        jobs_unblock();
+        fprintf(stderr, "bg: %s: no such job\n", args[1] != NULL ? args[1] : "current");
+        return 1;
+    }
+
+    job->background = true;
+    job->notified = false;
+    continue_job(app, job);
+    printf("[%d]+ %s &\n", job->id, job->command);
+
+    jobs_unblock();
+    return 0;
+}
+
+/**
+ * The "wait" builtin, waits for the given jobs or pids, or for every running job.
+ *
+ * @param app The app object.
+ * @param args The command's arguments, job specifications or pids.
+ * @return The exit status of the last job waited for, 127 if it does not exist.
+ */
+static int builtin_wait(app_t *app, char **args)
+{
+    int status = 0;
+
+    jobs_block();
+
+    if (args[1] == NULL)
+    {
+        for (int j = 0; j < jobs_count(); j++)
+        {
+            jobs_wait(jobs_get(j));
+        }
+
+        // Every job has been waited for, forget the finished ones
+        for (int j = 0; j < jobs_count(); j++)
+        {
+            if (jobs_get(j)->state == JOB_DONE)
+            {
+                jobs_remove(jobs_get(j));
+                j--;
+            }
+        }
+    }
+
+    for (int i = 1; args[i] != NULL; i++)
+    {
+        job_t *job = jobs_find(args[i]);
+        if (job == NULL)
+        {
+            fprintf(stderr, "wait: %s: no such job\n", args[i]);
+            status = 127;
+            continue;
+        }
+
+        jobs_wait(job);
+        if (job->state == JOB_STOPPED)
+        {
+            status = 128 + SIGTSTP;
+        }
+        else
+        {
+            status = job_status(job);
+            jobs_remove(job);
+        }
+    }
+
+    jobs_unblock();
+    return status;
+}
+
+/**
+ * Builds the command of a parallel task: the template with every "{}" replaced by the
+ * task's argument, or with the argument appended if the template has no "{}".
+ *
+ * @param template The command words, NULL terminated.
+ * @param argument The task's argument.
+ * @return The command, its words are heap allocated (see free_parallel_command()).
+ */
+static Command build_parallel_command(char **template, const char *argument)
+{
+    Command command = {.type = SIMPLE};
+    bool substituted = false;
+    size_t placeholder_length = strlen(PARALLEL_PLACEHOLDER);
+    size_t argument_length = strlen(argument);
+    int count = 0;
+
+    while (template[count] != NULL)
+    {
+        count++;
+    }
+
+    command.args = malloc(sizeof(char *) * (count + 2));
+    if (command.args == NULL)
+    {
+        perror("Error allocating memory for task");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const char *marker = strstr(template[i], PARALLEL_PLACEHOLDER);
+        if (marker == NULL)
+        {
+            command.args[i] = strdup(template[i]);
+            continue;
+        }
+
+        // Every "{}" of the word is replaced, e.g. sh -c "echo a{}; echo b{}"
+        size_t markers = 0;
+        for (const char *p = marker; p != NULL; p = strstr(p + placeholder_length, PARALLEL_PLACEHOLDER))
+        {
+            markers++;
+        }
+
+        size_t length = strlen(template[i]) - markers * placeholder_length + markers * argument_length;
+        command.args[i] = malloc(length + 1);
+        if (command.args[i] == NULL)
+        {
+            perror("Error allocating memory for task");
+            exit(EXIT_FAILURE);
+        }
+
+        char *out = command.args[i];
+        const char *rest = template[i];
+        for (; marker != NULL; marker = strstr(rest, PARALLEL_PLACEHOLDER))
+        {
+            memcpy(out, rest, marker - rest);
+            out += marker - rest;
+            memcpy(out, argument, argument_length);
+            out += argument_length;
+            rest = marker + placeholder_length;
+        }
+        strcpy(out, rest);
+        substituted = true;
+    }
+
+    command.args_length = count;
+    if (!substituted)
+    {
+        command.args[command.args_length++] = strdup(argument);
+    }
+    command.args[command.args_length] = NULL;
+
+    return command;
+}
+
+/**
+ * Frees the words of a command built by build_parallel_command().
+ *
+ * @param command The command.
+ */
+static void free_parallel_command(Command *command)
+{
+    for (int i = 0; i < command->args_length; i++)
+    {
+        free(command->args[i]);
+    }
+    free(command->args);
+}
+
+/**
+ * Starts a parallel task through the same spawn path as a pipeline. With grouped output,
+ * its standard output and error go to anonymous in-memory files until it finishes.
+ * SIGCHLD must be blocked.
+ *
+ * @param app The app object.
+ * @param task The task.
+ * @param template The command words, NULL terminated.
+ * @param argument The task's argument.
+ * @param group Whether to hold back the task's output until it finishes.
+ * @return true if the task was started.
+ */
+static bool start_parallel_task(app_t *app, parallel_task_t *task, char **template, const char *argument, bool group)
+{
+    // The tasks stay in the shell's process group, so Ctrl-C reaches them
+    stage_t stage = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, -1, -1, false};
+    redirects_t redirects = {{NULL, NULL, NULL}, {0, 0, 0}};
+    Command command = build_parallel_command(template, argument);
+
+    bool ready = true;
+
+    task->out_fd = -1;
+    task->err_fd = -1;
+    if (group)
+    {
+        task->out_fd = memfd_create("parallel-out", MFD_CLOEXEC);
+        task->err_fd = memfd_create("parallel-err", MFD_CLOEXEC);
+        if (task->out_fd == -1 || task->err_fd == -1)
+        {
+            // Only this task fails, it is reported as not started (127)
+            perror("parallel: memfd_create");
+            if (task->out_fd != -1)
+                close(task->out_fd);
+            if (task->err_fd != -1)
+                close(task->err_fd);
+            task->out_fd = -1;
+            task->err_fd = -1;
+            ready = false;
+        }
+        stage.out_fd = task->out_fd;
+        stage.err_fd = task->err_fd;
+    }
+
+    pid_t pid = ready ? launch_process(app, &command, &redirects, &stage) : -1;
+    task->job = jobs_add(pid > 0 ? pid : getpgrp(), &pid, 1, format_pipeline(&command, NULL), false);
+    task->job->notified = true; // reported by parallel itself, not before the prompt
+
+    free_parallel_command(&command);
+    return pid > 0;
+}
+
+/**
+ * Finishes a parallel task: records its exit status, writes out its grouped output in
+ * one piece and removes its job. SIGCHLD must be blocked.
+ *
+ * @param task The task.
+ * @param index The position of the task in the argument list.
+ * @param verbose Whether to report the task's exit status on standard error.
+ */
+static void finish_parallel_task(parallel_task_t *task, int index, bool verbose)
+{
+    task->status = job_status(task->job);
+
+    fflush(stdout);
+    fflush(stderr);
+
+    int fds[2] = {task->out_fd, task->err_fd};
+    for (int i = 0; i < 2; i++)
+    {
+        if (fds[i] == -1)
+        {
+            continue;
+        }
+
+        if (lseek(fds[i], 0, SEEK_SET) == 0)
+        {
+            copy_fd(fds[i], i == 0 ? STDOUT_FILENO : STDERR_FILENO);
+        }
+        close(fds[i]);
+    }
+
+    if (verbose)
+    {
+        fprintf(stderr, "parallel: [%d] exit %d  %s\n", index + 1, task->status, task->job->command);
+    }
+
+    jobs_remove(task->job);
+    task->job = NULL;
+}
+
+/**
+ * The "parallel" builtin, runs a command once per argument with at most N tasks at a time:
+ * "parallel [-j N] [-g] [-v] command [args...] ::: argument...". Each argument replaces
+ * "{}" in the command, or is appended to it. A new task is started as soon as one finishes.
+ * With -g the output of each task is printed in one piece when it finishes, so lines of
+ * different tasks never interleave. With -v the exit status of each task is reported.
+ * The exit status of each task is kept in $PIPESTATUS, in argument order.
+ *
+ * @param app The app object.
+ * @param args The command's arguments.
+ * @return The number of failed tasks (at most 101), 130 if interrupted, 2 on a usage error.
+ */
+static int builtin_parallel(app_t *app, char **args)
+{
+    long limit = sysconf(_SC_NPROCESSORS_ONLN);
+    bool group = false;
+    bool verbose = false;
+    int i = 1;
+
+    for (; args[i] != NULL && args[i][0] == '-'; i++)
+    {
+        if (strcmp(args[i], "-g") == 0)
+        {
+            group = true;
+        }
+        else if (strcmp(args[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (strncmp(args[i], "-j", 2) == 0)
+        {
+            const char *value = args[i][2] != '\0' ? args[i] + 2 : args[++i];
+            char *end;
+            limit = value != NULL ? strtol(value, &end, 10) : 0;
+            if (value == NULL || *end != '\0' || limit <= 0)
+            {
+                fprintf(stderr, "parallel: -j: invalid number of jobs\n");
+                return 2;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    char **template = &args[i];
+    int separator = i;
+    while (args[separator] != NULL && strcmp(args[separator], PARALLEL_SEPARATOR) != 0)
+    {
+        separator++;
+    }
+
+    if (separator == i || args[separator] == NULL)
+    {
+        fprintf(stderr, "parallel: usage: parallel [-j N] [-g] [-v] command [args...] ::: argument...\n");
+        return 2;
+    }
+
+    char **arguments = &args[separator + 1];
+    int task_count = 0;
+    while (arguments[task_count] != NULL)
+    {
+        task_count++;
+    }
+
+    // The template ends at the separator
+    args[separator] = NULL;
+
+    if (limit > task_count)
+    {
+        limit = task_count > 0 ? task_count : 1;
+    }
+
+    parallel_task_t *tasks = calloc(task_count > 0 ? task_count : 1, sizeof(parallel_task_t));
+    int *running = malloc(sizeof(int) * limit);
+    if (tasks == NULL || running == NULL)
+    {
+        perror("Error allocating memory for parallel");
+        exit(EXIT_FAILURE);
+    }
+
+    int next = 0;
+    int running_count = 0;
+    int failed = 0;
+    bool interrupted = false;
+
+    jobs_block();
+
+    while (next < task_count || running_count > 0)
+    {
+        // Keep the pool full
+        while (!interrupted && next < task_count && running_count < limit)
+        {
+            if (start_parallel_task(app, &tasks[next], template, arguments[next], group))
+            {
+                running[running_count++] = next;
+            }
+            else
+            {
+                finish_parallel_task(&tasks[next], next, verbose);
+                failed++;
+            }
+            next++;
+        }
+
+        if (running_count == 0)
+        {
+            break;
+        }
+
+        jobs_wait_any();
+
+        for (int r = 0; r < running_count; r++)
+        {
+            parallel_task_t *task = &tasks[running[r]];
+            if (task->job->state != JOB_DONE)
+            {
+                continue;
+            }
+
+            finish_parallel_task(task, running[r], verbose);
+            failed += task->status != 0;
+            interrupted |= task->status == 128 + SIGINT;
+            running[r--] = running[--running_count];
+        }
+    }
+
+    jobs_unblock();
+    args[separator] = PARALLEL_SEPARATOR;
+
+    // Tasks that never ran because of an interrupt are reported as interrupted
+    for (int t = next; t < task_count; t++)
+    {
+        tasks[t].status = 128 + SIGINT;
+    }
+
+    int status = interrupted ? 128 + SIGINT : (failed < PARALLEL_MAX_FAILED ? failed : PARALLEL_MAX_FAILED);
+
+    // $PIPESTATUS holds the status of every task
+    set_pipe_status_length(app, task_count);
+    for (int t = 0; t < task_count; t++)
+    {
+        app->pipe_status[t] = tasks[t].status;
+    }
+
+    free(tasks);
+    free(running);
+    return status;
+}
+
+/**
+ * @brief The builtin dispatch table.
+ */
+static const builtin_t builtins[] = {
+    {"cd", builtin_cd},
+    {"exit", builtin_exit},
+    {"help", builtin_help},
+    {"history", builtin_history},
+    {"hash", builtin_hash},
+    {"jobs", builtin_jobs},
+    {"fg", builtin_fg},
+    {"bg", builtin_bg},
+    {"wait", builtin_wait},
+    {"parallel", builtin_parallel},
+    {"echo", builtin_echo},
+    {"pwd", builtin_pwd},
+    {"true", builtin_true},
+    {"false", builtin_false},
+    {"printf", builtin_printf},
+    {"test", builtin_test},
+    {"[", builtin_test},
+};
+
+/**
+ * Looks up a builtin by name.
+ *
+ * @param name The command name.
+ * @return The builtin, or NULL if the command is not a builtin.
+ */
+const builtin_t *find_builtin(const char *name)
+{
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++)
+    {
+        if (strcmp(builtins[i].name, name) == 0)
+        {
+            return &builtins[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Collects the redirections that follow a command, e.g. "cmd < in > out 2> err".
+ * A later redirection of the same file descriptor overrides an earlier one.
+ *
+ * @param command The command the redirections apply to.
+ * @param redirects The redirections, indexed by the redirected file descriptor.
+ * @return The first node after the command and its redirections, or NULL at the end of the list.
+ */
+Command *collect_redirects(Command *command, redirects_t *redirects)
+{
+    memset(redirects, 0, sizeof(redirects_t));
+
+    Command *current = command->next;
+    while (current != NULL)
+    {
+        int fd;
+        int flags;
+
+        switch (current->type)
+        {
+        case REDIRECT_IN:
+            fd = STDIN_FILENO;
+            flags = O_RDONLY;
+            break;
+        case REDIRECT_OUT:
+            fd = STDOUT_FILENO;
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            break;
+        case REDIRECT_ERR:
+            fd = STDERR_FILENO;
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            break;
+        case REDIRECT_APP:
+            fd = STDOUT_FILENO;
+            flags = O_WRONLY | O_CREAT | O_APPEND;
+            break;
+        default:
+            return current;
+        }
+
+        // The redirection target is the first argument of the following node
+        Command *target = current->next;
+        if (target == NULL || target->args == NULL || target->args[0] == NULL)
+        {
+            fprintf(stderr, "dsh: missing redirection target\n");
+            return NULL;
+        }
+
+        redirects->path[fd] = target->args[0];
+        redirects->flags[fd] = flags;
+        current = target->next;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Signals the shell ignores but the commands it starts should not.
+ */
+static const int child_default_signals[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU};
+
+/**
+ * Closes the files opened for the redirections of a command.
+ *
+ * @param files The file opened for each descriptor, or -1.
+ */
+static void close_redirects(int files[3])
+{
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (files[fd] != -1)
+        {
+            close(files[fd]);
+        }
+    }
+}
+
+/**
+ * Starts a command with posix_spawn(). The pipe ends, redirections and process group
+ * are applied through spawn attributes and file actions, so the shell's address space
+ * is never copied.
+ *
+ * @param command The command to be executed.
+ * @param executable The resolved path of the command's executable.
+ * @param redirects The redirections of the command.
+ * @param stage How the command is connected to the rest of its pipeline.
+ * @return The pid of the child, or -1 if the command could not be started.
+ */
+pid_t spawn_process(Command *command, const char *executable, redirects_t *redirects, stage_t *stage)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t default_signals;
+    sigset_t mask;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+    pid_t pid;
+    int files[3] = {-1, -1, -1};
+
+    // Redirected files are opened here, so a failure names the file and not the command
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (redirects->path[fd] == NULL)
+        {
+            continue;
+        }
+
+        files[fd] = open(redirects->path[fd], redirects->flags[fd] | O_CLOEXEC, 0644);
+        if (files[fd] == -1)
+        {
+            fprintf(stderr, "dsh: %s: %s\n", redirects->path[fd], strerror(errno));
+            close_redirects(files);
+            return -1;
+        }
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+
+    // The shell ignores job control signals, the command should not inherit that
+    sigemptyset(&default_signals);
+    for (size_t i = 0; i < sizeof(child_default_signals) / sizeof(child_default_signals[0]); i++)
+    {
+        sigaddset(&default_signals, child_default_signals[i]);
+    }
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+
+    // Nor SIGCHLD being blocked while the pipeline is started
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+
+    if (stage->pgid != -1)
+    {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, stage->pgid);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+        // Hand the terminal over before the command can read from it
+        if (stage->foreground && stage->pgid == 0)
+        {
+            posix_spawn_file_actions_addtcsetpgrp_np(&actions, STDIN_FILENO);
+        }
+#endif
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    if (stage->read_fd != -1)
+    {
+        posix_spawn_file_actions_addclose(&actions, stage->read_fd);
+    }
+
+    if (stage->in_fd != STDIN_FILENO)
+    {
+        posix_spawn_file_actions_adddup2(&actions, stage->in_fd, STDIN_FILENO);
+        posix_spawn_file_actions_addclose(&actions, stage->in_fd);
+    }
+
+    if (stage->out_fd != STDOUT_FILENO)
+    {
+        posix_spawn_file_actions_adddup2(&actions, stage->out_fd, STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, stage->out_fd);
+    }
+
+    if (stage->err_fd != STDERR_FILENO)
+    {
+        posix_spawn_file_actions_adddup2(&actions, stage->err_fd, STDERR_FILENO);
+        posix_spawn_file_actions_addclose(&actions, stage->err_fd);
+    }
+
+    // The opened files are close-on-exec, only their duplicates are inherited
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (files[fd] != -1)
+        {
+            posix_spawn_file_actions_adddup2(&actions, files[fd], fd);
+        }
+    }
+
+    int err = posix_spawn(&pid, executable, &actions, &attr, command->args, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    close_redirects(files);
+
+    if (err != 0)
+    {
+        // The remembered executable may be stale, resolve the name again next time
+        if (err == ENOENT || err == EACCES)
+        {
+            path_hash_forget(command->args[0]);
+        }
+        fprintf(stderr, "%s: %s\n", command->args[0], strerror(err));
+        return -1;
+    }
+
+    return pid;
+}
+
+/**
+ * Prepares a forked child before it runs a command: joins the job's process group,
+ * restores the signals the shell ignores and moves the pipe ends and redirected files
+ * onto the standard file descriptors.
+ *
+ * @param redirects The redirections of the command.
+ * @param stage How the command is connected to the rest of its pipeline.
+ */
+static void setup_child(redirects_t *redirects, stage_t *stage)
+{
+    sigset_t mask;
+
+    if (stage->pgid != -1)
+    {
+        setpgid(0, stage->pgid);
+
+        // SIGTTOU is still ignored here, so the terminal can be taken from the shell
+        if (stage->foreground)
+        {
+            tcsetpgrp(STDIN_FILENO, getpgrp());
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(child_default_signals) / sizeof(child_default_signals[0]); i++)
+    {
+        signal(child_default_signals[i], SIG_DFL);
+    }
+    signal(SIGCHLD, SIG_DFL);
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+
+    if (stage->read_fd != -1)
+    {
+        close(stage->read_fd);
+    }
+
+    if (stage->in_fd != STDIN_FILENO)
+    {
+        dup2(stage->in_fd, STDIN_FILENO);
+        close(stage->in_fd);
+    }
+
+    if (stage->out_fd != STDOUT_FILENO)
+    {
+        dup2(stage->out_fd, STDOUT_FILENO);
+        close(stage->out_fd);
+    }
+
+    if (stage->err_fd != STDERR_FILENO)
+    {
+        dup2(stage->err_fd, STDERR_FILENO);
+        close(stage->err_fd);
+    }
+
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (redirects->path[fd] != NULL)
+        {
+            int file_fd = open(redirects->path[fd], redirects->flags[fd], 0644);
+            if (file_fd == -1)
+            {
+                fprintf(stderr, "dsh: %s: %s\n", redirects->path[fd], strerror(errno));
+                _exit(EXIT_FAILURE);
+            }
+            dup2(file_fd, fd);
+            close(file_fd);
+        }
+    }
+}
+
+/**
+ * Puts a forked child in its job's process group from the parent's side as well,
+ * so the group exists no matter which of the two runs first.
+ *
+ * @param pid The child.
+ * @param stage How the command is connected to the rest of its pipeline.
+ */
+static void set_child_group(pid_t pid, stage_t *stage)
+{
+    if (stage->pgid != -1)
+    {
+        setpgid(pid, stage->pgid != 0 ? stage->pgid : pid);
+    }
+}
+
+/**
+ * Starts a command with fork() and execve(), setting up the pipe ends and
+ * redirections in the child. The executable is checked before forking, so a stale
+ * remembered path is forgotten like after a failed posix_spawn().
+ *
+ * @param command The command to be executed.
+ * @param executable The resolved path of the command's executable.
+ * @param redirects The redirections of the command.
+ * @param stage How the command is connected to the rest of its pipeline.
+ * @return The pid of the child, or -1 if the executable cannot be run.
+ */
+pid_t fork_process(Command *command, const char *executable, redirects_t *redirects, stage_t *stage)
+{
+    if (access(executable, X_OK) == -1)
+    {
+        int err = errno;
+        fprintf(stderr, "%s: %s\n", command->args[0], strerror(err));
+        if (err == ENOENT || err == EACCES)
+        {
+            path_hash_forget(command->args[0]);
+        }
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) // fork a child process to handle the command execution
+    {
+        setup_child(redirects, stage);
+
+        // _exit(), the child must not run the shell's atexit handlers or flush its buffers
+        execve(executable, command->args, environ);
+        fprintf(stderr, "%s: %s\n", command->args[0], strerror(errno));
+        _exit(127);
+    }
+    else if (pid < 0)
+    {
+        perror("Error forking process");
+        exit(EXIT_FAILURE);
+    }
+
+    set_child_group(pid, stage);
+    return pid;
+}
+
+/**
+ * Runs a builtin in a forked child, for builtins that are a stage of a pipeline or run in the background.
+ *
+ * @param app The app object.
+ * @param builtin The builtin to be run.
+ * @param command The command to be executed.
+ * @param redirects The redirections of the command.
+ * @param stage How the command is connected to the rest of its pipeline.
+ * @return The pid of the child.
+ */
+pid_t fork_builtin(app_t *app, const builtin_t *builtin, Command *command, redirects_t *redirects, stage_t *stage)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        setup_child(redirects, stage);
+
+        int status = builtin->run(app, command->args);
+        fflush(stdout);
+        _exit(status);
+    }
+    else if (pid < 0)
+    {
+        perror("Error forking process");
+        exit(EXIT_FAILURE);
+    }
+
+    set_child_group(pid, stage);
+    return pid;
+}
+
+/**
+ * Runs a builtin in the shell process. Redirections are applied by temporarily swapping the
+ * shell's own file descriptors, which are restored once the builtin returns.
+ *
+ * @param app The app object the exit status is recorded in.
+ * @param builtin The builtin to be run.
+ * @param command The command to be executed.
+ * @param redirects The redirections of the command.
+ */
+void run_builtin(app_t *app, const builtin_t *builtin, Command *command, redirects_t *redirects)
+{
+    int saved[3] = {-1, -1, -1};
+    int status = 0;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (redirects->path[fd] == NULL)
+        {
+            continue;
+        }
+
+        int file_fd = open(redirects->path[fd], redirects->flags[fd], 0644);
+        if (file_fd == -1)
+        {
+            perror(redirects->path[fd]);
+            status = 1;
+            break;
+        }
+
+        saved[fd] = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+        dup2(file_fd, fd);
+        close(file_fd);
+    }
+
+    // Builtins that wait for other processes (fg, parallel) record their statuses themselves
+    app->pipe_status_length = 0;
+
+    if (status == 0)
+    {
+        status = builtin->run(app, command->args);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (saved[fd] != -1)
+        {
+            dup2(saved[fd], fd);
+            close(saved[fd]);
+        }
+    }
+
+    if (app->pipe_status_length == 0)
+    {
+        app->pipe_status[0] = status;
+        app->pipe_status_length = 1;
+    }
+    app->last_status = status;
+}
+
+/**
+ * Checks whether an input of cat is a regular file, which is copied to its end without
+ * waiting. Anything else, a terminal, a pipe or a device like /dev/zero, may never end,
+ * so it is left to the real cat, which Ctrl-C stops (the shell ignores SIGINT).
+ *
+ * @param path The input.
+ * @return true if it is a regular file.
+ */
+static bool is_regular_input(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+/**
+ * Checks whether a command only copies regular files into a redirected output, i.e.
+ * "cat file... > out" or "cat < in > out", which the shell can do itself without starting
+ * cat. A bare "cat > out" reads the terminal, it is left to the real cat.
+ *
+ * @param command The command.
+ * @param redirects The redirections of the command.
+ * @return true if the command can be run by run_copy().
+ */
+bool is_copy_command(Command *command, redirects_t *redirects)
+{
+    if (command->args == NULL || strcmp(command->args[0], "cat") != 0 || redirects->path[STDOUT_FILENO] == NULL)
+    {
+        return false;
+    }
+
+    if (command->args[1] == NULL)
+    {
+        return redirects->path[STDIN_FILENO] != NULL && is_regular_input(redirects->path[STDIN_FILENO]);
+    }
+
+    // Options, and "-" for stdin, are left to the real cat
+    for (int i = 1; command->args[i] != NULL; i++)
+    {
+        if (command->args[i][0] == '-' || !is_regular_input(command->args[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Checks whether an input of cat is the file it writes to, which would never reach its end.
+ *
+ * @param in_fd The input.
+ * @param out_st The status of the output.
+ * @return true if the input is the output.
+ */
+static bool is_output_file(int in_fd, const struct stat *out_st)
+{
+    struct stat in_st;
+    return fstat(in_fd, &in_st) == 0 && S_ISREG(in_st.st_mode) &&
+           in_st.st_dev == out_st->st_dev && in_st.st_ino == out_st->st_ino;
+}
+
+/**
+ * Runs a command accepted by is_copy_command() in the shell process. The data is moved by
+ * the kernel where possible (see copy_fd()), so no process is started and nothing is
+ * copied through user space.
+ *
+ * @param app The app object the exit status is recorded in.
+ * @param command The command.
+ * @param redirects The redirections of the command.
+ */
+void run_copy(app_t *app, Command *command, redirects_t *redirects)
+{
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    int status = 0;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO && status == 0; fd++)
+    {
+        if (redirects->path[fd] != NULL)
+        {
+            fds[fd] = open(redirects->path[fd], redirects->flags[fd] | O_CLOEXEC, 0644);
+            if (fds[fd] == -1)
+            {
+                perror(redirects->path[fd]);
+                status = 1;
+            }
+        }
+    }
+
+    struct stat out_st;
+    if (status == 0 && fstat(fds[STDOUT_FILENO], &out_st) == -1)
+    {
+        status = 1;
+    }
+
+    if (status != 0)
+    {
+        // A redirection failed, nothing is copied
+    }
+    else if (command->args[1] == NULL)
+    {
+        // Without operands cat copies its standard input
+        if (is_output_file(fds[STDIN_FILENO], &out_st))
+        {
+            dprintf(fds[STDERR_FILENO], "cat: -: input file is output file\n");
+            status = 1;
+        }
+        else if (copy_fd(fds[STDIN_FILENO], fds[STDOUT_FILENO]) == -1)
+        {
+            dprintf(fds[STDERR_FILENO], "cat: %s\n", strerror(errno));
+            status = 1;
+        }
+    }
+    else
+    {
+        for (int i = 1; command->args[i] != NULL; i++)
+        {
+            int in_fd = open(command->args[i], O_RDONLY | O_CLOEXEC);
+            if (in_fd == -1)
+            {
+                dprintf(fds[STDERR_FILENO], "cat: %s: %s\n", command->args[i], strerror(errno));
+                status = 1;
+                continue;
+            }
+
+            if (is_output_file(in_fd, &out_st))
+            {
+                dprintf(fds[STDERR_FILENO], "cat: %s: input file is output file\n", command->args[i]);
+                status = 1;
+            }
+            else if (copy_fd(in_fd, fds[STDOUT_FILENO]) == -1)
+            {
+                dprintf(fds[STDERR_FILENO], "cat: %s: %s\n", command->args[i], strerror(errno));
+                status = 1;
+            }
+
+            close(in_fd);
+        }
+    }
+
+    for (int fd = STDIN_FILENO; fd <= STDERR_FILENO; fd++)
+    {
+        if (fds[fd] != fd && fds[fd] != -1)
+        {
+            close(fds[fd]);
+        }
+    }
+
+    app->pipe_status[0] = status;
+    app->pipe_status_length = 1;
+    app->last_status = status;
+}
+
+/**
+ * Starts a command in a child process. The executable is resolved through the command
+ * hash, so PATH is not rescanned for every command. posix_spawn() is used unless it is
+ * disabled in the configuration, fork() is kept for commands that need work done in the child.
+ * Builtins that are a stage of a pipeline run in a forked child.
+ *
+ * @param app The app object containing the configuration.
+ * @param command The command to be executed.
+ * @param redirects The redirections of the command.
+ * @param stage How the command is connected to the rest of its pipeline.
+ * @return The pid of the child, or -1 if the command could not be started.
+ */
+pid_t launch_process(app_t *app, Command *command, redirects_t *redirects, stage_t *stage)
+{
+    // Output of earlier builtins must not be reordered after the child's output
+    fflush(stdout);
+
+    const builtin_t *builtin = find_builtin(command->args[0]);
+    if (builtin != NULL)
+    {
+        return fork_builtin(app, builtin, command, redirects, stage);
+    }
+
+    const char *executable = path_hash_lookup(command->args[0]);
+    if (executable == NULL)
+    {
+        fprintf(stderr, "%s: command not found\n", command->args[0]);
+        return -1;
+    }
+
+    if (app->config->processSpawn)
+    {
+        return spawn_process(command, executable, redirects, stage);
+    }
+
+    return fork_process(command, executable, redirects, stage);
+}
+
+/**
+ * Formats the command line of a pipeline for the job table, e.g. "sleep 10 &".
+ *
+ * @param command The first command of the pipeline.
+ * @param end The node that ended the pipeline, or NULL.
+ * @return The command line (heap allocated).
+ */
+char *format_pipeline(Command *command, Command *end)
+{
+    static const char *operators[] = {
+        [PIPE] = "|",
+        [REDIRECT_IN] = "<",
+        [REDIRECT_OUT] = ">",
+        [REDIRECT_ERR] = "2>",
+        [REDIRECT_APP] = ">>",
+        [BACKGROUND] = "&",
+        [SEQUENCE] = ";",
+        [CONDITIONAL] = "&&",
+    };
+
+    size_t length = 1;
+    for (Command *current = command; current != NULL; current = current->next)
+    {
+        for (int i = 0; current->type == SIMPLE && i < current->args_length; i++)
+        {
+            length += strlen(current->args[i]) + 1;
+        }
+        length += 3;
+        if (current == end)
+        {
+            break;
+        }
+    }
+
+    char *text = malloc(length);
+    if (text == NULL)
+    {
+        perror("Error allocating memory for job");
+        exit(EXIT_FAILURE);
+    }
+
+    size_t used = 0;
+    text[0] = '\0';
+    for (Command *current = command; current != NULL; current = current->next)
+    {
+        if (current->type == SIMPLE)
+        {
+            for (int i = 0; i < current->args_length; i++)
+            {
+                used += sprintf(text + used, used > 0 ? " %s" : "%s", current->args[i]);
+            }
+        }
+        else if (current != end || current->type == BACKGROUND)
+        {
+            used += sprintf(text + used, used > 0 ? " %s" : "%s", operators[current->type]);
         }
-        else
+
+        if (current == end)
         {
-            snprintf(prompt, MAX_BUFFER_SIZE, "%s%s%s ", user, at, basename(app->current_directory));
+            break;
         }
     }
 
-    return prompt;
+    return text;
 }
 
 /**
- * Reads user input from the command line and stores it in the application buffer.
+ * Waits for a job in the foreground, giving it the terminal while it runs, and records the
+ * exit statuses of its stages. A job that is stopped stays in the job table. SIGCHLD must be blocked.
  *
- * @param app The application structure containing the buffer to store the input.
+ * @param app The app object the statuses are recorded in.
+ * @param job The job.
  */
-void read_input(app_t *app)
+void wait_foreground(app_t *app, job_t *job)
 {
-    char *line_read = linenoise(print_prompt(app));
-
-    if (line_read == NULL)
+    if (app->interactive)
     {
-        free(line_read);
-        return;
+        tcsetpgrp(STDIN_FILENO, job->pgid);
     }
 
-    if (*line_read)
+    jobs_wait(job);
+
+    if (app->interactive)
     {
-        linenoiseHistoryAdd(line_read);
-        linenoiseHistorySave(app->config->historyFile ? app->config->historyFile : HISTORY_FILE);
+        tcsetpgrp(STDIN_FILENO, app->shell_pgid);
     }
 
-    // handle tilde expansion
-    char *home_dir = getenv("HOME");
-    char *tilde_pos = NULL;
-    while ((tilde_pos = strstr(line_read, "~")) != NULL)
+    set_pipe_status_length(app, job->stage_count);
+    for (int i = 0; i < job->stage_count; i++)
     {
-        char *new_line_read = malloc(strlen(line_read) + strlen(home_dir) + 1);
-        strncpy(new_line_read, line_read, tilde_pos - line_read);
-        new_line_read[tilde_pos - line_read] = '\0';
-        strcat(new_line_read, home_dir);
-        strcat(new_line_read, tilde_pos + 1);
-        free(line_read);
-        line_read = new_line_read;
+        app->pipe_status[i] = job->statuses[i];
     }
 
-    app->app_buffer->buffer = strdup(line_read);
-    app->app_buffer->buffer_length = strlen(app->app_buffer->buffer);
-
-    if (app->app_buffer->buffer_length <= 0)
+    if (job->state == JOB_STOPPED)
     {
-        exit(0);
+        job->background = true;
+        job->notified = true;
+        printf("\n[%d]+  Stopped   %s\n", job->id, job->command);
+        app->last_status = 128 + SIGTSTP;
+        return;
     }
+
+    app->last_status = job_status(job);
+    jobs_remove(job);
 }
 
 /**
- * Parses the tokens in the app buffer and creates a command list.
- * Each token is checked for its value and a corresponding command is created.
- * The command list is stored in the app buffer.
+ * Returns the largest pipe buffer an unprivileged process may ask for.
  *
- * @param app The app structure containing the app buffer.
+ * @return The limit in bytes, read once from /proc/sys/fs/pipe-max-size.
  */
-void parse_tokens(app_t *app)
+static long pipe_size_limit()
 {
+    static long limit = 0;
 
-    Token *token_list = app->app_buffer->token_list;
-    Command *last_command = new_command(SIMPLE, NULL, 0);
-
-    int i = 0;
-    while (token_list != NULL)
+    if (limit == 0)
     {
-
-        char **args = NULL;
-        int args_length = 0;
-
-        if (strcmp(token_list->value, "|") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(PIPE, args, args_length);
-        }
-        else if (strcmp(token_list->value, "<") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(REDIRECT_IN, args, args_length);
-        }
-        else if (strcmp(token_list->value, ">") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(REDIRECT_OUT, args, args_length);
-        }
-        else if (strcmp(token_list->value, "2>") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(REDIRECT_ERR, args, args_length);
-        }
-        else if (strcmp(token_list->value, ">>") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(REDIRECT_APP, args, args_length);
-        }
-        else if (strcmp(token_list->value, "&") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(BACKGROUND, args, args_length);
-        }
-        else if (strcmp(token_list->value, ";") == 0)
-        {
-            last_command->next = app->app_buffer->command_list[i] = new_command(SEQUENCE, args, args_length);
-        }
-        else if (strcmp(token_list->value, "&&") == 0)
+        FILE *fp = fopen(PIPE_MAX_SIZE_FILE, "r");
+        if (fp == NULL || fscanf(fp, "%ld", &limit) != 1 || limit <= 0)
         {
-            last_command->next = app->app_buffer->command_list[i] = new_command(CONDITIONAL, args, args_length);
+            limit = 1 << 20; // the kernel's default limit
         }
-        else
+        if (fp != NULL)
         {
-            get_args(token_list, &args, &args_length, app);
-            last_command->next = app->app_buffer->command_list[i] = new_command(SIMPLE, args, args_length);
+            fclose(fp);
         }
+    }
 
-        last_command = last_command->next;
-        i++;
+    return limit;
+}
 
-        if (args_length > 0)
-        {
-            for (int i = 0; i < args_length; i++)
-            {
-                token_list = token_list->next;
-            }
-        }
-        else
-        {
+/**
+ * Resizes the buffer of a pipe, capped at the system limit. A failure leaves the
+ * pipe at its current size, e.g. when the user's pipe buffer quota is exhausted.
+ *
+ * @param fd Either end of the pipe.
+ * @param size The requested size in bytes, 0 to keep the kernel default.
+ */
+static void set_pipe_size(int fd, long size)
+{
+    if (size <= 0)
+    {
+        return;
+    }
 
-            token_list = token_list->next;
-        }
+    if (size > pipe_size_limit())
+    {
+        size = pipe_size_limit();
     }
+
+    fcntl(fd, F_SETPIPE_SZ, (int)size);
 }
 
 /**
- * Extracts arguments from a linked list of tokens.
+ * Takes a "PIPE_BUFFER_SIZE=<size>" prefix off a pipeline, e.g. "PIPE_BUFFER_SIZE=1M a | b",
+ * which overrides the configured pipe buffer size for that pipeline only.
  *
- * @param token The head of the linked list of tokens.
- * @param args Pointer to the array of arguments.
- * @param args_length Pointer to the length of the args array.
+ * @param command The first command of the pipeline.
+ * @param size The pipe buffer size, replaced if the pipeline has a valid prefix.
  */
-
-void get_args(Token *token, char ***args, int *args_length, app_t *app)
+static void pipe_size_override(Command *command, long *size)
 {
-    Token *current = token;
-    int i = 0;
+    size_t prefix_length = strlen(PIPE_BUFFER_SIZE_PREFIX);
 
-    // Allocate memory for args
-    *args = malloc(sizeof(char *) * (MAX_ARGS + 1)); // Allocate an extra element for the NULL pointer
-    if (*args == NULL)
+    if (command->args == NULL || strncmp(command->args[0], PIPE_BUFFER_SIZE_PREFIX, prefix_length) != 0)
     {
-        printf("Error allocating memory for args\n");
         return;
     }
 
-    while (current != NULL)
+    long value = parse_size(command->args[0] + prefix_length);
+    if (value < 0)
+    {
+        fprintf(stderr, "dsh: invalid pipe buffer size: %s\n", command->args[0] + prefix_length);
+    }
+    else
+    {
+        *size = value;
+    }
+
+    command->args++;
+    command->args_length--;
+    if (command->args_length == 0)
+    {
+        command->args = NULL;
+    }
+}
+
+/**
+ * Runs a pipeline, e.g. "a | b | c". Every stage is started before any of them is waited for,
+ * so the stages run concurrently and a stage filling its pipe never waits on an unstarted reader.
+ * Pipes get the configured PIPE_BUFFER_SIZE, or the size given by a "PIPE_BUFFER_SIZE=<size>" prefix.
+ *
+ * @param app The app object containing the configuration.
+ * @param command The first command of the pipeline.
+ * @return The node that ended the pipeline (";", "&&" or "&"), or NULL at the end of the list.
+ */
+Command *run_pipeline(app_t *app, Command *command)
+{
+    pid_t first_pids[MAX_PIPELINE_STAGES];
+    pid_t *pids = first_pids;
+    int capacity = MAX_PIPELINE_STAGES;
+    int stages = 0;
+    int pipefd[2];
+    Command *first = command;
+    Command *after = NULL;
+    long pipe_size = app->config->pipeBufferSize;
+
+    // With job control every job gets its own process group, led by its first process
+    stage_t stage = {.in_fd = STDIN_FILENO, .err_fd = STDERR_FILENO, .pgid = app->interactive ? 0 : -1};
+    bool background = is_background(command);
+
+    expand_pipeline_status(app, command);
+    pipe_size_override(command, &pipe_size);
+
+    // Children must not be reaped before their job is in the job table
+    uint64_t started = profile_start();
+    jobs_block();
+
+    while (command != NULL)
     {
-        if (strcmp(current->value, "|") == 0 || strcmp(current->value, "<") == 0 || strcmp(current->value, ">") == 0 || strcmp(current->value, "2>") == 0 || strcmp(current->value, ">>") == 0 || strcmp(current->value, "&") == 0 || strcmp(current->value, ";") == 0 || strcmp(current->value, "&&") == 0)
+        redirects_t redirects;
+        after = collect_redirects(command, &redirects);
+        bool piped = after && after->type == PIPE;
+
+        // A builtin on its own runs in the shell, without forking
+        bool alone = !piped && stages == 0 && !background;
+        const builtin_t *builtin = command->args != NULL ? find_builtin(command->args[0]) : NULL;
+        if (builtin != NULL && alone)
         {
-            break;
+            jobs_unblock();
+            run_builtin(app, builtin, command, &redirects);
+            profile_record(PROFILE_EXEC, started);
+            return after;
         }
 
-        if (strcmp(current->value, "Editor") == 0)
+        // So does "cat file > out", the kernel copies the data
+        if (alone && is_copy_command(command, &redirects))
         {
-            // Replace "Editor" with the value of config->editor
-            char *editor_value = app->config->editor;
-            if (editor_value == NULL)
-            {
-                printf("Editor is not set in the configuration\n");
-                return;
-            }
-
-            // Make a copy of the editor value
-            char *editor_value_copy = malloc(strlen(editor_value) + 1);
-            if (editor_value_copy == NULL)
-            {
-                printf("Error allocating memory for editor value\n");
-                return;
-            }
-            strcpy(editor_value_copy, editor_value);
+            jobs_unblock();
+            run_copy(app, command, &redirects);
+            profile_record(PROFILE_EXEC, started);
+            return after;
+        }
 
-            (*args)[i] = editor_value_copy;
+        stage.out_fd = STDOUT_FILENO; // reset out_fd to stdout for each command
+        stage.read_fd = -1;
+        stage.foreground = !background;
 
-            printf("Editor value: %s\n", editor_value_copy);
-        }
-        // Check if the token is an environment variable
-        else if (current->value[0] == '$')
+        if (piped)
         {
-            // Get the value of the environment variable
-            char *env_value = getenv(current->value + 1);
-            if (env_value == NULL)
+            if (pipe(pipefd) == -1)
             {
-                printf("Undefined environment variable: %s\n", current->value);
-                return;
+                perror("pipe");
+                exit(EXIT_FAILURE);
             }
+            set_pipe_size(pipefd[1], pipe_size);
+            stage.out_fd = pipefd[1]; // set out_fd to write end of the pipe
+            stage.read_fd = pipefd[0];
+        }
 
-            // Make a copy of the environment variable value
-            char *env_value_copy = malloc(strlen(env_value) + 1);
-            if (env_value_copy == NULL)
-            {
-                printf("Error allocating memory for environment variable value\n");
-                return;
-            }
-            strcpy(env_value_copy, env_value);
+        pid_t pid = command->args != NULL ? launch_process(app, command, &redirects, &stage) : -1;
+        // Every stage started is waited for, longer pipelines keep their pids in the arena
+        if (stages == capacity)
+        {
+            pid_t *grown = arena_alloc(app->app_buffer->arena, sizeof(pid_t) * capacity * 2);
+            memcpy(grown, pids, sizeof(pid_t) * stages);
+            pids = grown;
+            capacity *= 2;
+        }
+        pids[stages++] = pid;
 
-            (*args)[i] = env_value_copy;
+        if (pid > 0 && stage.pgid == 0)
+        {
+            stage.pgid = pid;
         }
-        else
+
+        if (stage.in_fd != STDIN_FILENO)
+            close(stage.in_fd);
+
+        if (!piped)
         {
-            (*args)[i] = strdup(current->value);
+            stage.in_fd = STDIN_FILENO;
+            break;
         }
 
-        current = current->next;
-        i++;
+        close(pipefd[1]);
+        stage.in_fd = pipefd[0];
+        command = after->next;
     }
 
-    (*args)[i] = NULL; // Add the NULL pointer at the end of the args array
-    *args_length = i;
-}
+    // A trailing "|" leaves the read end of the last pipe open
+    if (stage.in_fd != STDIN_FILENO)
+        close(stage.in_fd);
 
-/**
- * Tokenizes the input string and stores the tokens in the args array.
- * Each token is separated by a space character.
- * The newline character at the end of each token is removed.
- *
- * @param input The input string to be tokenized.
- * @param args The array to store the tokens.
- */
-void prep_args(char *input, char **args)
-{
-    char *token = strtok(input, " ");
-    int i = 0;
-    while (token != NULL)
+    pid_t pgid = stage.pgid > 0 ? stage.pgid : getpgrp();
+    job_t *job = jobs_add(pgid, pids, stages, format_pipeline(first, after), background);
+    profile_record(PROFILE_EXEC, started);
+
+    if (background)
     {
-        // Remove newline character at the end of each token
-        size_t len = strlen(token);
-        if (token[len - 1] == '\n')
+        if (app->interactive)
         {
-            token[len - 1] = '\0';
+            printf("[%d] %ld\n", job->id, (long)pgid);
         }
-
-        args[i] = token;
-        token = strtok(NULL, " ");
-        i++;
+        app->last_status = 0;
     }
-    args[i] = NULL;
+    else
+    {
+        started = profile_start();
+        wait_foreground(app, job);
+        profile_record(PROFILE_WAIT, started);
+    }
+
+    jobs_unblock();
+    return after;
 }
 
 /**
- * Changes the current working directory to the specified path.
+ * Checks whether a pipeline runs in the background, i.e. it ends with "&".
  *
- * @param path The path of the directory to change to.
+ * @param command The first command of the pipeline.
+ * @return true if the pipeline ends with "&".
  */
-void change_dir(char *path)
+bool is_background(Command *command)
 {
-    if (chdir(path) != 0)
+    for (; command != NULL; command = command->next)
     {
-        perror("Error changing directory");
+        if (command->type == BACKGROUND)
+        {
+            return true;
+        }
+
+        if (command->type == SEQUENCE || command->type == CONDITIONAL)
+        {
+            return false;
+        }
     }
+
+    return false;
 }
 
 /**
- * Prints the help information for the shell program.
+ * Skips a pipeline without running it.
+ *
+ * @param command The first command of the pipeline.
+ * @return The node that ended the pipeline, or NULL at the end of the list.
  */
-void print_help()
-{
-    printf("DSH (Dash Shell) - A minimal shell\n\n");
-    printf("Built-in Commands:\n");
-    printf("cd <directory> - Change the current working directory to <directory>\n");
-    printf("exit - Terminate the shell process\n");
-    printf("help - Display this help information\n");
-    printf("history - Display the command history\n");
-    printf("\n");
-
-    printf("Redirection and Piping:\n");
-    printf("<command> > <file> - Redirect the output of <command> to <file>\n");
-    printf("<command> >> <file> - Append the output of <command> to <file>\n");
-    printf("<command> < <file> - Use <file> as the input to <command>\n");
-    printf("<command> 2> <file> - Redirect the error output of <command> to <file>\n");
-    printf("<command1> | <command2> - Pipe the output of <command1> to the input of <command2>\n");
-    printf("\n");
-
-    printf("Background Execution:\n");
-    printf("<command> & - Execute <command> in the background\n");
-    printf("\n");
-
-    printf("RC System:\n");
-    printf("DSH reads a startup file (~/.dshrc) that can contain any shell commands.\n");
-    printf("These commands are executed when the shell starts.\n");
-    printf("This can be used to set environment variables, define aliases, and more.\n");
-    printf("\n");
-}
-
-void print_history()
+Command *skip_pipeline(Command *command)
 {
-    FILE *file = fopen(HISTORY_FILE, "r");
-    if (file == NULL)
+    while (command != NULL)
     {
-        perror("Error opening HISTORY file");
-        return;
-    }
+        redirects_t redirects;
+        Command *after = collect_redirects(command, &redirects);
 
-    char line[256];
-    while (fgets(line, sizeof(line), file))
-    {
-        printf("%s", line);
+        if (after == NULL || after->type != PIPE)
+        {
+            return after;
+        }
+        command = after->next;
     }
 
-    fclose(file);
+    return NULL;
 }
 
 /**
  * Executes the command handler.
  *
- * This function takes an app object as input and executes the command specified in the app's command list.
- * It checks the type of the command and performs the corresponding action.
- * If the command is "cd", it changes the current directory.
- * If the command is "exit", it exits the program.
- * If the command is "help", it prints the help message.
- * If the command is "history", it prints the command history.
- * For other commands, it forks a child process to handle the command execution.
+ * This function takes an app object as input and executes the commands in the app's command list.
+ * It runs each pipeline of the line with run_pipeline(), which starts every stage before reaping
+ * them. Pipelines are separated by ";", "&&" and "&". Builtins (see find_builtin()) run in the
+ * shell unless they are part of a pipeline.
  * It handles input/output redirection and piping if necessary.
  *
  * @param app The app object containing the command list.
@@ -551,141 +2846,22 @@ void exec_handler(app_t *app)
 {
     Command *current_command = app->app_buffer->command_list[0];
 
-    if (current_command == NULL || current_command->args[0] == NULL)
+    if (current_command == NULL || current_command->args == NULL || current_command->args[0] == NULL)
     {
         return;
     }
-    else if (strcmp(current_command->args[0], "cd") == 0)
-    {
-        change_dir(current_command->args[1]);
-    }
-    else if (strcmp(current_command->args[0], "exit") == 0)
-    {
-        exit(0);
-    }
-    else if (strcmp(current_command->args[0], "help") == 0)
-    {
-        print_help();
-    }
-    else if (strcmp(current_command->args[0], "history") == 0)
-    {
-        print_history();
-    }
-    else
+
+    while (current_command != NULL)
     {
-        int pipefd[2];
-        int in_fd = 0; // input file descriptor, start with stdin
-        int out_fd;    // output file descriptor
-        int err_fd;    // error file descriptor
+        Command *end = run_pipeline(app, current_command);
 
-        while (current_command != NULL)
+        // "a && b" only runs b if a succeeded, a skipped pipeline keeps the failing status
+        while (end != NULL && end->type == CONDITIONAL && app->last_status != 0)
         {
-            out_fd = STDOUT_FILENO; // reset out_fd to stdout for each command
-            err_fd = STDERR_FILENO; // reset err_fd to stderr for each command
-
-            if (current_command->next && current_command->next->type == PIPE)
-            {
-                if (pipe(pipefd) == -1)
-                {
-                    perror("pipe");
-                    exit(EXIT_FAILURE);
-                }
-                out_fd = pipefd[1]; // set out_fd to write end of the pipe
-            }
-
-            pid_t pid = fork();
-            if (pid == 0) // fork a child process to handle the command execution
-            {
-                signal(SIGINT, SIG_DFL);
-
-                if (current_command->next && current_command->next->type == REDIRECT_OUT)
-                {
-                    out_fd = open(current_command->next->next->args[0], O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                    if (out_fd == -1)
-                    {
-                        perror("open");
-                        exit(EXIT_FAILURE);
-                    }
-                }
-
-                if (current_command->next && current_command->next->type == REDIRECT_IN)
-                {
-                    in_fd = open(current_command->next->next->args[0], O_RDONLY);
-                    if (in_fd == -1)
-                    {
-                        perror("open");
-                        exit(EXIT_FAILURE);
-                    }
-                }
-
-                if (current_command->next && current_command->next->type == REDIRECT_ERR)
-                {
-                    err_fd = open(current_command->next->next->args[0], O_WRONLY | O_CREAT | O_TRUNC, 0644);
-                    if (err_fd == -1)
-                    {
-                        perror("open");
-                        exit(EXIT_FAILURE);
-                    }
-                }
-
-                if (current_command->next && current_command->next->type == REDIRECT_APP)
-                {
-                    out_fd = open(current_command->next->next->args[0], O_WRONLY | O_CREAT | O_APPEND, 0644);
-                    if (out_fd == -1)
-                    {
-                        perror("open");
-                        exit(EXIT_FAILURE);
-                    }
-                }
-
-                if (in_fd != STDIN_FILENO)
-                {
-                    dup2(in_fd, STDIN_FILENO);
-                    close(in_fd);
-                }
-
-                if (out_fd != STDOUT_FILENO)
-                {
-                    dup2(out_fd, STDOUT_FILENO);
-                    close(out_fd);
-                }
-
-                if (err_fd != STDERR_FILENO)
-                {
-                    dup2(err_fd, STDERR_FILENO);
-                    close(err_fd);
-                }
-
-                if (execvp(current_command->args[0], current_command->args) == -1)
-                {
-                    perror("execvp");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            else if (pid < 0)
-            {
-                perror("Error forking process");
-                exit(EXIT_FAILURE);
-            }
-            else
-            {
-                if (current_command->type != BACKGROUND)
-                {
-                    wait(NULL);
-                }
-
-                if (in_fd != 0)
-                    close(in_fd);
-
-                if (current_command->next && current_command->next->type == PIPE)
-                {
-                    close(pipefd[1]);
-                    in_fd = pipefd[0];
-                }
-
-                current_command = current_command->next ? current_command->next->next : NULL;
-            }
+            end = skip_pipeline(end->next);
         }
+
+        current_command = end ? end->next : NULL;
     }
 }
 
@@ -716,40 +2892,79 @@ void print_commands(Command *command)
 }
 
 /**
- * Searches for completions in a history file based on user input.
+ * Finds the word being typed when it is a command name, i.e. the first word of the line
+ * or the first word after "|", ";" or "&".
  *
  * @param buf The user's input.
- * @param lc A pointer to the linenoiseCompletions struct where completions will be added.
+ * @return The offset of the word, or -1 if the end of the input is not in command position.
  */
-void completion(const char *buf, linenoiseCompletions *lc)
+static ssize_t command_word_start(const char *buf)
 {
-    FILE *file = fopen(HISTORY_FILE, "r");
-    if (file == NULL)
+    size_t start = 0;
+
+    for (size_t i = 0; buf[i] != '\0'; i++)
     {
-        return;
+        if (buf[i] == '|' || buf[i] == ';' || buf[i] == '&')
+        {
+            start = i + 1;
+        }
     }
 
-    char *line = NULL;
-    size_t len = 0;
-    while (getline(&line, &len, file) != -1)
+    start += strspn(buf + start, " \t");
+    return strpbrk(buf + start, " \t") == NULL ? (ssize_t)start : -1;
+}
+
+/**
+ * Finds the word being typed, i.e. the text after the last blank or operator.
+ *
+ * @param buf The user's input.
+ * @return The offset of the word, the length of the input if no word is started.
+ */
+static size_t last_word_start(const char *buf)
+{
+    size_t start = 0;
+
+    for (size_t i = 0; buf[i] != '\0'; i++)
     {
-        // Remove newline character
-        line[strcspn(line, "\n")] = 0;
+        if (strchr(" \t|;&<>", buf[i]) != NULL)
+        {
+            start = i + 1;
+        }
+    }
 
-        // If the line in the history file starts with the user's input, add it as a completion
-        if (strncmp(buf, line, strlen(buf)) == 0)
+    return start;
+}
+
+/**
+ * Searches for completions based on user input: executables in PATH while a command name
+ * is typed, file names from the cached directory listings for arguments and paths, then
+ * the most used lines of the in-memory history index.
+ *
+ * @param buf The user's input.
+ * @param lc A pointer to the linenoiseCompletions struct where completions will be added.
+ */
+void completion(const char *buf, linenoiseCompletions *lc)
+{
+    ssize_t start = command_word_start(buf);
+    if (start != -1 && strchr(buf + start, '/') == NULL)
+    {
+        if (buf[start] != '\0')
         {
-            linenoiseAddCompletion(lc, line);
+            command_index_complete(buf, start, lc);
         }
     }
+    else if (completion_app != NULL)
+    {
+        dir_cache_complete(buf, last_word_start(buf), completion_app->current_directory, lc);
+    }
 
-    free(line);
-    fclose(file);
+    history_index_complete(buf, lc);
 }
 
 /**
- * Returns a hint based on the user's input by searching through a history file.
- * The hint is a line from the history file that starts with the user's input.
+ * Returns a hint based on the user's input by looking it up in the in-memory history index.
+ * The hint is the history line starting with the user's input that was run most often
+ * and most recently.
  *
  * @param buf The user's input string.
  * @param color A pointer to an integer variable to store the color of the hint.
@@ -758,32 +2973,15 @@ void completion(const char *buf, linenoiseCompletions *lc)
  */
 char *hints(const char *buf, int *color, int *bold)
 {
-    FILE *file = fopen(HISTORY_FILE, "r");
-    if (file == NULL)
+    const char *line = history_index_hint(buf);
+    if (line == NULL)
     {
         return NULL;
     }
 
-    char *line = NULL;
-    size_t len = 0;
-    while (getline(&line, &len, file) != -1)
-    {
-        // Remove newline character
-        line[strcspn(line, "\n")] = 0;
-
-        // If the line in the history file starts with the user's input, return it as a hint
-        if (strncmp(buf, line, strlen(buf)) == 0)
-        {
-            fclose(file);
-            *color = 36; // Set hint color to magenta
-            *bold = 0;
-            return line + strlen(buf); // Return the part of the line that's not yet typed
-        }
-    }
-
-    free(line);
-    fclose(file);
-    return NULL;
+    *color = 36; // Set hint color to magenta
+    *bold = 0;
+    return (char *)line + strlen(buf); // Return the part of the line that's not yet typed
 }
 
 /**
@@ -795,7 +2993,7 @@ void free_buffer(buff_t *buffer)
 {
     if (buffer)
     {
-        free(buffer->buffer);
+        free_arena(buffer->arena);
         free(buffer->command_list);
         free(buffer);
     }
@@ -813,6 +3011,7 @@ void free_app(app_t *app)
         free_buffer(app->app_buffer);
         free_cmd_buffer(app->cmd_buffer);
         free(app->current_directory);
+        free(app->pipe_status);
         free(app);
     }
 }
@@ -831,36 +3030,19 @@ void free_cmd_buffer(cmdBuffer_t *buffer)
 }
 
 /**
- * Frees all commands in a linked list of Command structures.
+ * Resets a buffer after a line has been executed. The line, its tokens and its
+ * commands all live in the buffer's arena, so they are released in one step.
  *
- * @param command A pointer to the head of the linked list of Command structures.
+ * @param buffer The buffer to be reset.
  */
-void free_commands(Command **command)
+void reset_buffer(buff_t *buffer)
 {
-    Command *current = *command;
-    Command *next;
-
-    while (current != NULL)
-    {
-        next = current->next;
-
-        // Free the memory allocated for the command's arguments
-        for (int i = 0; i < current->args_length; i++)
-        {
-            free(current->args[i]);
-        }
-
-        // Free the memory allocated for the command's args array
-        free(current->args);
-
-        // Free the memory allocated for the command itself
-        free(current);
-
-        current = next;
-    }
-
-    // Set the head of the linked list to NULL
-    *command = NULL;
+    arena_reset(buffer->arena);
+    buffer->buffer = NULL;
+    buffer->buffer_length = 0;
+    buffer->tokens = NULL;
+    buffer->token_count = 0;
+    buffer->command_list[0] = NULL;
 }
 
 /**
@@ -882,4 +3064,11 @@ void print_config(config_t *config)
     printf("History File: %s\n", config->historyFile ? config->historyFile : "NULL");
     printf("History Size: %d\n", config->historySize);
     printf("Editor: %s\n", config->editor ? config->editor : "NULL");
+    printf("Process Spawn: %s\n", config->processSpawn ? "true" : "false");
+    printf("Script Cache: %s\n", config->scriptCache ? "true" : "false");
+    printf("Pipe Buffer Size: %ld\n", config->pipeBufferSize);
+    printf("Prompt Git Status: %s\n", config->promptGitStatus ? "true" : "false");
+    printf("Profile File: %s\n", config->profileFile ? config->profileFile : "NULL");
+    printf("Profile Format: %s\n", config->profileFormat ? config->profileFormat : "NULL");
+    printf("History Format: %s\n", config->historyFormat ? config->historyFormat : "NULL");
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+/***************************************************************************/ /**
+   @file         pathhash.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "pathhash.h"
+
+/**
+ * @brief The command hash table, like the "hash" builtin of other shells.
+ *
+ * The table maps command names to executables and is only valid for the PATH it was
+ * built for. A cached entry is trusted as long as neither its own directory nor any
+ * directory before it in PATH has been modified, since only those can add or remove
+ * an executable that changes the result of the lookup.
+ */
+static struct
+{
+    PathHashEntry *entries; /**< Open addressing table with linear probing. */
+    size_t capacity;        /**< The number of slots, always a power of two. */
+    size_t count;           /**< The number of used slots. */
+    char *path;             /**< The PATH value the directories were split from. */
+    PathDir *dirs;          /**< The PATH directories. */
+    int dir_count;          /**< The number of PATH directories. */
+} table;
+
+/**
+ * Hashes a command name (FNV-1a).
+ *
+ * @param name The command name.
+ * @return The hash of the name.
+ */
+static uint64_t hash_name(const char *name)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const unsigned char *p = (const unsigned char *)name; *p != '\0'; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Finds the slot of a command name, or the empty slot where it should be inserted.
+ *
+ * @param entries The table slots.
+ * @param capacity The number of slots.
+ * @param name The command name.
+ * @return A pointer to the slot.
+ */
+static PathHashEntry *find_slot(PathHashEntry *entries, size_t capacity, const char *name)
+{
+    size_t i = hash_name(name) & (capacity - 1);
+
+    while (entries[i].name != NULL && strcmp(entries[i].name, name) != 0)
+    {
+        i = (i + 1) & (capacity - 1);
+    }
+
+    return &entries[i];
+}
+
+/**
+ * Stores the modification time of a directory, or zero if it cannot be read.
+ *
+ * @param dir The PATH directory.
+ * @param mtime The modification time.
+ */
+static void read_mtime(const char *dir, struct timespec *mtime)
+{
+    struct stat st;
+
+    if (stat(dir, &st) == 0)
+    {
+        *mtime = st.st_mtim;
+    }
+    else
+    {
+        mtime->tv_sec = 0;
+        mtime->tv_nsec = 0;
+    }
+}
+
+/**
+ * Removes every entry from the table and records the current directory modification times.
+ */
+static void clear_entries(void)
+{
+    for (size_t i = 0; i < table.capacity; i++)
+    {
+        free(table.entries[i].name);
+        free(table.entries[i].path);
+    }
+
+    if (table.entries != NULL)
+    {
+        memset(table.entries, 0, sizeof(PathHashEntry) * table.capacity);
+    }
+    table.count = 0;
+
+    for (int i = 0; i < table.dir_count; i++)
+    {
+        read_mtime(table.dirs[i].path, &table.dirs[i].mtime);
+    }
+}
+
+/**
+ * Splits a PATH value into its directories. An empty element stands for the current directory.
+ *
+ * @param path The PATH value.
+ */
+static void load_dirs(const char *path)
+{
+    for (int i = 0; i < table.dir_count; i++)
+    {
+        free(table.dirs[i].path);
+    }
+    free(table.dirs);
+    free(table.path);
+
+    table.path = strdup(path);
+    table.dir_count = 1;
+    for (const char *p = path; *p != '\0'; p++)
+    {
+        table.dir_count += *p == ':';
+    }
+
+    table.dirs = calloc(table.dir_count, sizeof(PathDir));
+    if (table.path == NULL || table.dirs == NULL)
+    {
+        perror("Error allocating memory for command hash");
+        exit(EXIT_FAILURE);
+    }
+
+    const char *start = path;
+    for (int i = 0; i < table.dir_count; i++)
+    {
+        const char *end = strchr(start, ':');
+        size_t length = end != NULL ? (size_t)(end - start) : strlen(start);
+
+        table.dirs[i].path = length > 0 ? strndup(start, length) : strdup(".");
+        start = end != NULL ? end + 1 : start + length;
+    }
+
+    clear_entries();
+}
+
+/**
+ * Checks that the PATH directories up to and including a given one are unchanged.
+ *
+ * @param last The index of the last directory to check.
+ * @return true if none of the directories changed since the table was validated.
+ */
+static bool dirs_unchanged(int last)
+{
+    for (int i = 0; i <= last && i < table.dir_count; i++)
+    {
+        struct timespec mtime;
+        read_mtime(table.dirs[i].path, &mtime);
+
+        if (mtime.tv_sec != table.dirs[i].mtime.tv_sec || mtime.tv_nsec != table.dirs[i].mtime.tv_nsec)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Doubles the capacity of the table.
+ */
+static void grow_table(void)
+{
+    size_t capacity = table.capacity ? table.capacity * 2 : PATH_HASH_INITIAL_CAPACITY;
+    PathHashEntry *entries = calloc(capacity, sizeof(PathHashEntry));
+    if (entries == NULL)
+    {
+        perror("Error allocating memory for command hash");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < table.capacity; i++)
+    {
+        if (table.entries[i].name != NULL)
+        {
+            *find_slot(entries, capacity, table.entries[i].name) = table.entries[i];
+        }
+    }
+
+    free(table.entries);
+    table.entries = entries;
+    table.capacity = capacity;
+}
+
+/**
+ * Searches the PATH directories for an executable.
+ *
+ * @param name The command name.
+ * @param dir_index The index of the directory the executable was found in.
+ * @return The path of the executable (heap allocated), or NULL if it was not found.
+ */
+static char *search_dirs(const char *name, int *dir_index)
+{
+    char candidate[PATH_MAX];
+    struct stat st;
+
+    for (int i = 0; i < table.dir_count; i++)
+    {
+        snprintf(candidate, sizeof(candidate), "%s/%s", table.dirs[i].path, name);
+
+        if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0)
+        {
+            *dir_index = i;
+            return strdup(candidate);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Resolves a command name to the executable that execvp() would run, using the command hash.
+ *
+ * @param name The command name.
+ * @return The path of the executable, or NULL if it is not found in PATH. Names containing a
+ *         slash are returned unchanged. The string is owned by the table.
+ */
+const char *path_hash_lookup(const char *name)
+{
+    if (strchr(name, '/') != NULL)
+    {
+        return name;
+    }
+
+    const char *path = getenv("PATH");
+    if (path == NULL)
+    {
+        path = PATH_HASH_DEFAULT_PATH;
+    }
+
+    if (table.path == NULL || strcmp(table.path, path) != 0)
+    {
+        load_dirs(path);
+    }
+
+    if (table.capacity > 0)
+    {
+        PathHashEntry *entry = find_slot(table.entries, table.capacity, name);
+        if (entry->name != NULL)
+        {
+            if (dirs_unchanged(entry->dir_index))
+            {
+                entry->hits++;
+                return entry->path;
+            }
+
+            clear_entries();
+        }
+    }
+
+    int dir_index;
+    char *executable = search_dirs(name, &dir_index);
+    if (executable == NULL)
+    {
+        return NULL;
+    }
+
+    if ((table.count + 1) * 2 > table.capacity)
+    {
+        grow_table();
+    }
+
+    PathHashEntry *entry = find_slot(table.entries, table.capacity, name);
+    entry->name = strdup(name);
+    entry->path = executable;
+    entry->dir_index = dir_index;
+    entry->hits = 1;
+    table.count++;
+
+    return entry->path;
+}
+
+/**
+ * Removes a command from the hash, e.g. after executing its cached path failed.
+ *
+ * @param name The command name.
+ */
+void path_hash_forget(const char *name)
+{
+    if (table.capacity == 0)
+    {
+        return;
+    }
+
+    PathHashEntry *entry = find_slot(table.entries, table.capacity, name);
+    if (entry->name == NULL)
+    {
+        return;
+    }
+
+    free(entry->name);
+    free(entry->path);
+    entry->name = NULL;
+    entry->path = NULL;
+    table.count--;
+
+    // Re-insert the rest of the probe cluster so later lookups don't stop at the hole
+    size_t i = (entry - table.entries + 1) & (table.capacity - 1);
+    while (table.entries[i].name != NULL)
+    {
+        PathHashEntry moved = table.entries[i];
+        table.entries[i].name = NULL;
+        *find_slot(table.entries, table.capacity, moved.name) = moved;
+        i = (i + 1) & (table.capacity - 1);
+    }
+}
+
+/**
+ * Forgets every remembered command ("hash -r").
+ */
+void path_hash_reset(void)
+{
+    clear_entries();
+}
+
+/**
+ * Prints the remembered commands and how often each was used ("hash").
+ */
+void path_hash_print(void)
+{
+    if (table.count == 0)
+    {
+        printf("hash: hash table empty\n");
+        return;
+    }
+
+    printf("hits\tcommand\n");
+    for (size_t i = 0; i < table.capacity; i++)
+    {
+        if (table.entries[i].name != NULL)
+        {
+            printf("%4u\t%s\n", table.entries[i].hits, table.entries[i].path);
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         pathhash.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <time.h>
+
+// Macros
+#define PATH_HASH_INITIAL_CAPACITY 64
+#define PATH_HASH_DEFAULT_PATH "/usr/local/bin:/usr/bin:/bin"
+
+/**
+ * @struct PathHashEntry
+ * @brief A command name resolved to an executable in one of the PATH directories.
+ */
+typedef struct PathHashEntry
+{
+  char *name;         /**< The command name, NULL for an empty slot. */
+  char *path;         /**< The absolute path of the executable. */
+  int dir_index;      /**< The index of the PATH directory the executable was found in. */
+  unsigned int hits;  /**< The number of times the entry was used. */
+} PathHashEntry;
+
+/**
+ * @struct PathDir
+ * @brief A PATH directory and its modification time when the table was last validated.
+ */
+typedef struct PathDir
+{
+  char *path;            /**< The directory. */
+  struct timespec mtime; /**< The modification time, zero if the directory does not exist. */
+} PathDir;
+
+// Function Prototypes
+const char *path_hash_lookup(const char *name);
+void path_hash_forget(const char *name);
+void path_hash_reset(void);
+void path_hash_print(void);
@@ -0,0 +1,284 @@
+/***************************************************************************/ /**
+   @file         profile.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "profile.h"
+
+/**
+ * @brief Names of the phases, as written to the profile.
+ */
+static const char *phase_names[PROFILE_PHASE_COUNT] = {
+    [PROFILE_PROMPT] = "prompt",
+    [PROFILE_READ] = "read",
+    [PROFILE_HISTORY] = "history",
+    [PROFILE_TOKENIZE] = "tokenize",
+    [PROFILE_PARSE] = "parse",
+    [PROFILE_EXEC] = "exec",
+    [PROFILE_WAIT] = "wait",
+};
+
+/**
+ * @brief The profile being written.
+ *
+ * Every phase adds its duration to the current line. JSON Lines output gets one record
+ * per line once it has been executed; Chrome trace output gets an event per phase as it
+ * ends and one for the whole line.
+ */
+static struct
+{
+    FILE *file;                                /**< The profile file, NULL when profiling is off. */
+    profile_format_t format;                   /**< The output format. */
+    uint64_t origin;                           /**< When the profile was opened, trace timestamps are relative to it. */
+    uint64_t line_start;                       /**< When the first phase of the current line started, 0 if none did. */
+    uint64_t durations[PROFILE_PHASE_COUNT];   /**< The time spent in every phase of the current line. */
+    long line_number;                          /**< The number of the current line, from 1. */
+    char *command;                             /**< The current line. */
+    bool first_event;                          /**< Whether no trace event was written yet. */
+    pid_t owner;                               /**< The shell process, forked children must not write the profile. */
+} profile;
+
+/**
+ * Returns the current monotonic time.
+ *
+ * @return The time in nanoseconds.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Writes a string as a JSON string literal.
+ *
+ * @param file The file to write to.
+ * @param value The string.
+ */
+static void write_json_string(FILE *file, const char *value)
+{
+    fputc('"', file);
+
+    for (const unsigned char *p = (const unsigned char *)value; *p != '\0'; p++)
+    {
+        if (*p == '"' || *p == '\\')
+        {
+            fprintf(file, "\\%c", *p);
+        }
+        else if (*p < 0x20)
+        {
+            fprintf(file, "\\u%04x", *p);
+        }
+        else
+        {
+            fputc(*p, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+/**
+ * Writes a Chrome trace complete event ("ph": "X").
+ *
+ * @param name The name of the event.
+ * @param start When the event started.
+ * @param end When the event ended.
+ */
+static void write_trace_event(const char *name, uint64_t start, uint64_t end)
+{
+    fprintf(profile.file, "%s{\"name\":\"%s\",\"cat\":\"dsh\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld,\"args\":{\"line\":%ld",
+            profile.first_event ? "" : ",\n", name, (start - profile.origin) / 1e3, (end - start) / 1e3,
+            (long)getpid(), (long)getpid(), profile.line_number);
+
+    if (profile.command != NULL && strcmp(name, "line") == 0)
+    {
+        fprintf(profile.file, ",\"command\":");
+        write_json_string(profile.file, profile.command);
+    }
+
+    fprintf(profile.file, "}}");
+    profile.first_event = false;
+}
+
+/**
+ * Starts writing a profile of the main loop.
+ *
+ * @param path The file to write the profile to, it is truncated.
+ * @param format "jsonl" for JSON Lines, "chrome" for the Chrome trace event format, NULL for JSON Lines.
+ * @return false if the format is unknown or the file cannot be opened.
+ */
+bool profile_open(const char *path, const char *format)
+{
+    if (format == NULL || strcmp(format, "jsonl") == 0)
+    {
+        profile.format = PROFILE_JSONL;
+    }
+    else if (strcmp(format, "chrome") == 0)
+    {
+        profile.format = PROFILE_CHROME;
+    }
+    else
+    {
+        fprintf(stderr, "dsh: unknown profile format: %s\n", format);
+        return false;
+    }
+
+    profile.file = fopen(path, "w");
+    if (profile.file == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    profile.origin = now_ns();
+    profile.line_number = 1;
+    profile.first_event = true;
+    profile.owner = getpid();
+
+    if (profile.format == PROFILE_CHROME)
+    {
+        fprintf(profile.file, "[\n");
+    }
+
+    // "exit" ends the shell from inside a builtin
+    atexit(profile_close);
+    return true;
+}
+
+/**
+ * Finishes the profile and closes its file.
+ */
+void profile_close(void)
+{
+    if (profile.file == NULL || profile.owner != getpid())
+    {
+        return;
+    }
+
+    if (profile.format == PROFILE_CHROME)
+    {
+        fprintf(profile.file, "\n]\n");
+    }
+
+    fclose(profile.file);
+    profile.file = NULL;
+    free(profile.command);
+    profile.command = NULL;
+}
+
+/**
+ * Checks whether a profile is being written.
+ *
+ * @return true if profiling is on.
+ */
+bool profile_enabled(void)
+{
+    return profile.file != NULL;
+}
+
+/**
+ * Marks the start of a phase.
+ *
+ * @return The current time, or 0 when profiling is off so no clock is read.
+ */
+uint64_t profile_start(void)
+{
+    return profile.file != NULL ? now_ns() : 0;
+}
+
+/**
+ * Marks the end of a phase and adds its duration to the current line.
+ *
+ * @param phase The phase.
+ * @param start The value profile_start() returned when the phase started.
+ */
+void profile_record(profile_phase_t phase, uint64_t start)
+{
+    if (profile.file == NULL || start == 0)
+    {
+        return;
+    }
+
+    uint64_t end = now_ns();
+    profile.durations[phase] += end - start;
+
+    if (profile.line_start == 0 || start < profile.line_start)
+    {
+        profile.line_start = start;
+    }
+
+    if (profile.format == PROFILE_CHROME)
+    {
+        write_trace_event(phase_names[phase], start, end);
+    }
+}
+
+/**
+ * Sets the text of the current line, before it is tokenized in place.
+ *
+ * @param line The line.
+ */
+void profile_line_begin(const char *line)
+{
+    if (profile.file == NULL)
+    {
+        return;
+    }
+
+    free(profile.command);
+    profile.command = strdup(line);
+
+    if (profile.line_start == 0)
+    {
+        profile.line_start = now_ns();
+    }
+}
+
+/**
+ * Writes the record of the current line once it has been executed, and starts the next line.
+ */
+void profile_line_end(void)
+{
+    if (profile.file == NULL)
+    {
+        return;
+    }
+
+    uint64_t end = now_ns();
+    uint64_t start = profile.line_start != 0 ? profile.line_start : end;
+
+    if (profile.format == PROFILE_CHROME)
+    {
+        write_trace_event("line", start, end);
+    }
+    else
+    {
+        fprintf(profile.file, "{\"line\":%ld,\"command\":", profile.line_number);
+        write_json_string(profile.file, profile.command != NULL ? profile.command : "");
+        fprintf(profile.file, ",\"start_us\":%.3f,\"total_us\":%.3f", (start - profile.origin) / 1e3, (end - start) / 1e3);
+
+        for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++)
+        {
+            fprintf(profile.file, ",\"%s_us\":%.3f", phase_names[phase], profile.durations[phase] / 1e3);
+        }
+
+        fprintf(profile.file, "}\n");
+    }
+
+    memset(profile.durations, 0, sizeof(profile.durations));
+    profile.line_start = 0;
+    profile.line_number++;
+    free(profile.command);
+    profile.command = NULL;
+}
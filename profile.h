@@ -0,0 +1,45 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         profile.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Enumeration representing the phases of the main loop that are timed.
+ */
+typedef enum ProfilePhase
+{
+  PROFILE_PROMPT,   // Building the prompt, including the git status
+  PROFILE_READ,     // Reading the line, including the time spent typing
+  PROFILE_HISTORY,  // Adding the line to the history and saving it
+  PROFILE_TOKENIZE, // Splitting the line into tokens
+  PROFILE_PARSE,    // Building the command list
+  PROFILE_EXEC,     // Starting the processes of the pipelines
+  PROFILE_WAIT,     // Waiting for foreground pipelines
+  PROFILE_PHASE_COUNT
+} profile_phase_t;
+
+/**
+ * @brief Enumeration representing the output formats of the profile.
+ */
+typedef enum ProfileFormat
+{
+  PROFILE_JSONL, // One JSON object per line, with the time spent in every phase
+  PROFILE_CHROME // Chrome trace events, one complete event per phase
+} profile_format_t;
+
+// Function Prototypes
+bool profile_open(const char *path, const char *format);
+void profile_close(void);
+bool profile_enabled(void);
+uint64_t profile_start(void);
+void profile_record(profile_phase_t phase, uint64_t start);
+void profile_line_begin(const char *line);
+void profile_line_end(void);
@@ -0,0 +1,477 @@
+/***************************************************************************/ /**
+   @file         scriptcache.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "scriptcache.h"
+
+/**
+ * Rounds a length up to the 4 byte alignment of the records.
+ *
+ * @param length The length.
+ * @return The padded length.
+ */
+static size_t pad4(size_t length)
+{
+    return (length + 3) & ~(size_t)3;
+}
+
+/**
+ * Builds the path of the cache file of a script. Cache files live in $XDG_CACHE_HOME/dsh
+ * (or ~/.cache/dsh) and are named after a hash of the script's absolute path.
+ *
+ * @param script The path of the script.
+ * @param resolved Receives the absolute path of the script (PATH_MAX bytes).
+ * @param create Whether to create the cache directory if it is missing.
+ * @return The path of the cache file (heap allocated), or NULL if there is no usable cache directory.
+ */
+static char *cache_file_path(const char *script, char *resolved, bool create)
+{
+    if (realpath(script, resolved) == NULL)
+    {
+        return NULL;
+    }
+
+    char dir[PATH_MAX];
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    if (xdg != NULL && xdg[0] == '/')
+    {
+        snprintf(dir, sizeof(dir), "%s", xdg);
+    }
+    else if (home != NULL)
+    {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+    }
+    else
+    {
+        return NULL;
+    }
+
+    if (create)
+    {
+        mkdir(dir, 0700);
+    }
+
+    size_t length = strlen(dir);
+    snprintf(dir + length, sizeof(dir) - length, "/%s", SCRIPT_CACHE_DIR);
+
+    if (create)
+    {
+        mkdir(dir, 0700);
+    }
+
+    // FNV-1a of the absolute path
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)resolved; *p != '\0'; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+
+    char *path = malloc(strlen(dir) + 32);
+    if (path == NULL)
+    {
+        return NULL;
+    }
+
+    sprintf(path, "%s/%016llx.dshc", dir, (unsigned long long)hash);
+    return path;
+}
+
+/**
+ * Reads a 32 bit field of a record, checking that it lies within the cache file.
+ *
+ * @param cache The cache.
+ * @param offset The offset of the field, advanced past it.
+ * @param value Receives the value.
+ * @return true if the field is within the file.
+ */
+static bool read_u32(const script_cache_t *cache, size_t *offset, uint32_t *value)
+{
+    if (*offset + sizeof(uint32_t) > cache->length)
+    {
+        return false;
+    }
+
+    memcpy(value, cache->data + *offset, sizeof(uint32_t));
+    *offset += sizeof(uint32_t);
+    return true;
+}
+
+/**
+ * Walks every record of a cache file once, so a truncated or corrupted file is rejected
+ * before any of its lines are run.
+ *
+ * @param cache The cache, positioned at the first line record.
+ * @return true if every record lies within the file.
+ */
+static bool validate_records(const script_cache_t *cache)
+{
+    size_t offset = cache->offset;
+
+    for (uint32_t line = 0; line < cache->lines_left; line++)
+    {
+        uint32_t node_count;
+        if (!read_u32(cache, &offset, &node_count) || node_count == 0)
+        {
+            return false;
+        }
+
+        for (uint32_t node = 0; node < node_count; node++)
+        {
+            uint32_t type, argc;
+            if (!read_u32(cache, &offset, &type) || !read_u32(cache, &offset, &argc) || type > CONDITIONAL)
+            {
+                return false;
+            }
+
+            for (uint32_t arg = 0; arg < argc; arg++)
+            {
+                uint32_t length;
+                if (!read_u32(cache, &offset, &length) || length >= cache->length ||
+                    offset + pad4((size_t)length + 1) > cache->length || cache->data[offset + length] != '\0')
+                {
+                    return false;
+                }
+                offset += pad4((size_t)length + 1);
+            }
+        }
+    }
+
+    return offset == cache->length;
+}
+
+/**
+ * Opens the cache file of a script, if it was written for the script's current contents.
+ *
+ * @param cache The cache to open.
+ * @param script The path of the script.
+ * @param st The status of the script.
+ * @return 0 if the cache is valid, -1 if it is missing or stale.
+ */
+int script_cache_open(script_cache_t *cache, const char *script, const struct stat *st)
+{
+    char resolved[PATH_MAX];
+    char *path = cache_file_path(script, resolved, false);
+    if (path == NULL)
+    {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    struct stat cache_st;
+    if (fstat(fd, &cache_st) == -1 || (size_t)cache_st.st_size < sizeof(ScriptCacheHeader))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    cache->data = data;
+    cache->length = cache_st.st_size;
+
+    ScriptCacheHeader header;
+    memcpy(&header, cache->data, sizeof(header));
+
+    size_t path_offset = sizeof(header);
+    size_t resolved_length = strlen(resolved);
+
+    bool valid = header.magic == SCRIPT_CACHE_MAGIC &&
+                 header.version == SCRIPT_CACHE_VERSION &&
+                 header.size == (uint64_t)st->st_size &&
+                 header.mtime_sec == (int64_t)st->st_mtim.tv_sec &&
+                 header.mtime_nsec == (int64_t)st->st_mtim.tv_nsec &&
+                 header.inode == (uint64_t)st->st_ino &&
+                 header.path_length == pad4(resolved_length + 1) &&
+                 path_offset + header.path_length <= cache->length &&
+                 memcmp(cache->data + path_offset, resolved, resolved_length + 1) == 0;
+
+    if (valid)
+    {
+        cache->offset = path_offset + header.path_length;
+        cache->lines_left = header.line_count;
+        valid = validate_records(cache);
+    }
+
+    if (!valid)
+    {
+        script_cache_close(cache);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Rebuilds the Command chain of the next line of a cached script. Arguments point
+ * straight into the mapped cache file and must not be modified.
+ *
+ * @param cache The cache.
+ * @param arena The arena the commands and argument arrays are allocated from.
+ * @return The first command of the line, or NULL after the last line.
+ */
+Command *script_cache_next(script_cache_t *cache, arena_t *arena)
+{
+    if (cache->lines_left == 0)
+    {
+        return NULL;
+    }
+    cache->lines_left--;
+
+    // The records were validated when the cache was opened
+    uint32_t node_count;
+    read_u32(cache, &cache->offset, &node_count);
+
+    Command *first = NULL;
+    Command *last = NULL;
+
+    for (uint32_t node = 0; node < node_count; node++)
+    {
+        uint32_t type, argc;
+        read_u32(cache, &cache->offset, &type);
+        read_u32(cache, &cache->offset, &argc);
+
+        char **args = NULL;
+        if (argc > 0)
+        {
+            args = arena_alloc(arena, sizeof(char *) * (argc + 1));
+            for (uint32_t i = 0; i < argc; i++)
+            {
+                uint32_t length;
+                read_u32(cache, &cache->offset, &length);
+                args[i] = (char *)cache->data + cache->offset;
+                cache->offset += pad4((size_t)length + 1);
+            }
+            args[argc] = NULL;
+        }
+
+        Command *command = new_command((command_t)type, args, (int)argc, arena);
+        if (last != NULL)
+        {
+            last->next = command;
+        }
+        else
+        {
+            first = command;
+        }
+        last = command;
+    }
+
+    return first;
+}
+
+/**
+ * Unmaps a cache file.
+ *
+ * @param cache The cache.
+ */
+void script_cache_close(script_cache_t *cache)
+{
+    if (cache->data != NULL)
+    {
+        munmap((void *)cache->data, cache->length);
+    }
+
+    cache->data = NULL;
+    cache->length = 0;
+    cache->offset = 0;
+    cache->lines_left = 0;
+}
+
+/**
+ * Starts writing the cache file of a script.
+ *
+ * @param script The path of the script.
+ * @param st The status of the script the cache is written for.
+ * @return The writer, or NULL if the cache file cannot be created.
+ */
+script_cache_writer_t *script_cache_create(const char *script, const struct stat *st)
+{
+    char resolved[PATH_MAX];
+    char *path = cache_file_path(script, resolved, true);
+    if (path == NULL)
+    {
+        return NULL;
+    }
+
+    script_cache_writer_t *writer = calloc(1, sizeof(script_cache_writer_t));
+    char *tmp_path = malloc(strlen(path) + 32);
+    if (writer == NULL || tmp_path == NULL)
+    {
+        free(writer);
+        free(tmp_path);
+        free(path);
+        return NULL;
+    }
+
+    // A private temporary name, so concurrent runs never read a half written cache
+    sprintf(tmp_path, "%s.%ld.tmp", path, (long)getpid());
+    writer->path = path;
+    writer->tmp_path = tmp_path;
+    writer->file = fopen(tmp_path, "wb");
+    if (writer->file == NULL)
+    {
+        free(tmp_path);
+        free(path);
+        free(writer);
+        return NULL;
+    }
+
+    size_t resolved_length = strlen(resolved);
+    writer->header.magic = SCRIPT_CACHE_MAGIC;
+    writer->header.version = SCRIPT_CACHE_VERSION;
+    writer->header.size = st->st_size;
+    writer->header.mtime_sec = st->st_mtim.tv_sec;
+    writer->header.mtime_nsec = st->st_mtim.tv_nsec;
+    writer->header.inode = st->st_ino;
+    writer->header.line_count = 0;
+    writer->header.path_length = pad4(resolved_length + 1);
+
+    static const char padding[4] = {0};
+    fwrite(&writer->header, sizeof(writer->header), 1, writer->file);
+    fwrite(resolved, 1, resolved_length, writer->file);
+    fwrite(padding, 1, writer->header.path_length - resolved_length, writer->file);
+
+    return writer;
+}
+
+/**
+ * Appends the Command chain of one line to a cache file.
+ *
+ * @param writer The writer.
+ * @param command The first command of the line.
+ * @return 0 on success, -1 if the line was not written.
+ */
+int script_cache_write_line(script_cache_writer_t *writer, Command *command)
+{
+    static const char padding[4] = {0};
+    uint32_t node_count = 0;
+
+    for (Command *current = command; current != NULL; current = current->next)
+    {
+        node_count++;
+    }
+
+    if (node_count == 0)
+    {
+        return -1;
+    }
+
+    fwrite(&node_count, sizeof(node_count), 1, writer->file);
+
+    for (Command *current = command; current != NULL; current = current->next)
+    {
+        uint32_t type = current->type;
+        uint32_t argc = current->args != NULL ? (uint32_t)current->args_length : 0;
+
+        fwrite(&type, sizeof(type), 1, writer->file);
+        fwrite(&argc, sizeof(argc), 1, writer->file);
+
+        for (uint32_t i = 0; i < argc; i++)
+        {
+            uint32_t length = strlen(current->args[i]);
+            fwrite(&length, sizeof(length), 1, writer->file);
+            fwrite(current->args[i], 1, length, writer->file);
+            fwrite(padding, 1, pad4((size_t)length + 1) - length, writer->file);
+        }
+    }
+
+    // Buffered writes only report errors through the stream
+    if (ferror(writer->file))
+    {
+        return -1;
+    }
+
+    writer->header.line_count++;
+    return 0;
+}
+
+/**
+ * Frees a writer.
+ *
+ * @param writer The writer.
+ */
+static void free_writer(script_cache_writer_t *writer)
+{
+    free(writer->path);
+    free(writer->tmp_path);
+    free(writer);
+}
+
+/**
+ * Completes a cache file and moves it into place.
+ *
+ * @param writer The writer, freed by this call.
+ * @return 0 on success, -1 if the cache could not be written.
+ */
+int script_cache_finish(script_cache_writer_t *writer)
+{
+    int err = 0;
+
+    // The line count is only known now
+    if (fseek(writer->file, 0, SEEK_SET) != 0 ||
+        fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1)
+    {
+        err = -1;
+    }
+
+    if (ferror(writer->file))
+    {
+        err = -1;
+    }
+
+    if (fclose(writer->file) != 0)
+    {
+        err = -1;
+    }
+
+    if (err == 0 && rename(writer->tmp_path, writer->path) != 0)
+    {
+        err = -1;
+    }
+
+    if (err != 0)
+    {
+        unlink(writer->tmp_path);
+    }
+
+    free_writer(writer);
+    return err;
+}
+
+/**
+ * Discards a cache file that is being written.
+ *
+ * @param writer The writer, freed by this call.
+ */
+void script_cache_abort(script_cache_writer_t *writer)
+{
+    fclose(writer->file);
+    unlink(writer->tmp_path);
+    free_writer(writer);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         scriptcache.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include "types.h"
+
+// Macros
+#define SCRIPT_CACHE_MAGIC 0x43485344 // "DSHC"
+#define SCRIPT_CACHE_VERSION 1
+#define SCRIPT_CACHE_DIR "dsh"
+
+/**
+ * @struct ScriptCacheHeader
+ * @brief The header of a parsed-script cache file.
+ *
+ * The header is followed by the script path and one record per executable line:
+ *
+ *   line:    uint32 node_count, node_count * node
+ *   node:    uint32 type, uint32 argc, argc * arg
+ *   arg:     uint32 length, length bytes, NUL, padding to 4 bytes
+ *
+ * Nodes are the Command chain built by the parser, with arguments stored before
+ * variable and tilde expansion, which still happen every time the line runs.
+ */
+typedef struct ScriptCacheHeader
+{
+  uint32_t magic;       /**< SCRIPT_CACHE_MAGIC. */
+  uint32_t version;     /**< SCRIPT_CACHE_VERSION, bumped whenever the record layout or command types change. */
+  uint64_t size;        /**< The size of the script when it was parsed. */
+  int64_t mtime_sec;    /**< The modification time of the script when it was parsed. */
+  int64_t mtime_nsec;   /**< The nanoseconds of the modification time. */
+  uint64_t inode;       /**< The inode of the script when it was parsed. */
+  uint32_t line_count;  /**< The number of line records. */
+  uint32_t path_length; /**< The length of the padded, NUL terminated script path that follows. */
+} ScriptCacheHeader;
+
+/**
+ * @struct ScriptCache
+ * @brief A cache file mapped for reading.
+ */
+typedef struct ScriptCache
+{
+  const char *data;     /**< The mapped cache file. */
+  size_t length;        /**< The length of the mapping. */
+  size_t offset;        /**< The offset of the next line record. */
+  uint32_t lines_left;  /**< The number of line records not yet read. */
+} script_cache_t;
+
+/**
+ * @struct ScriptCacheWriter
+ * @brief A cache file being written. It only replaces the cache once it is complete.
+ */
+typedef struct ScriptCacheWriter
+{
+  FILE *file;                /**< The temporary file. */
+  char *path;                /**< The path of the cache file. */
+  char *tmp_path;            /**< The path of the temporary file. */
+  ScriptCacheHeader header;  /**< The header, rewritten once the line count is known. */
+} script_cache_writer_t;
+
+// Function Prototypes
+int script_cache_open(script_cache_t *cache, const char *script, const struct stat *st);
+Command *script_cache_next(script_cache_t *cache, arena_t *arena);
+void script_cache_close(script_cache_t *cache);
+script_cache_writer_t *script_cache_create(const char *script, const struct stat *st);
+int script_cache_write_line(script_cache_writer_t *writer, Command *command);
+int script_cache_finish(script_cache_writer_t *writer);
+void script_cache_abort(script_cache_writer_t *writer);
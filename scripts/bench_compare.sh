@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Compares two saved "make bench" outputs, e.g. from two commits:
+#   make bench > before.txt; (change, rebuild) make bench > after.txt
+#   scripts/bench_compare.sh before.txt after.txt
+# Every measurement with percentiles is matched by its name and parameters,
+# and the change of its median (p50) is printed.
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 before.txt after.txt"
+    exit 2
+fi
+
+awk '
+    # The key of a measurement is everything before "samples="
+    function key(line) { sub(/ samples=.*/, "", line); return line }
+    function median(line,    fields, i, n) {
+        n = split(line, fields, " ")
+        for (i = 1; i <= n; i++) if (fields[i] ~ /^p50_/) return fields[i]
+        return ""
+    }
+    FNR == NR { if ($0 ~ / p50_/) before[key($0)] = median($0); next }
+    $0 ~ / p50_/ {
+        k = key($0); now = median($0)
+        if (!(k in before)) { printf "%-60s %s (new)\n", k, now; next }
+        split(before[k], old, "="); split(now, cur, "=")
+        change = old[2] != 0 ? (cur[2] - old[2]) / old[2] * 100 : 0
+        printf "%-60s %s -> %s (%+.1f%%)\n", k, before[k], cur[2], change
+    }
+' "$1" "$2"
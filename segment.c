@@ -0,0 +1,138 @@
+/***************************************************************************/ /**
+   @file         segment.c
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+#define _GNU_SOURCE
+
+// Library Imports
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include "segment.h"
+
+extern char **environ;
+
+/**
+ * @brief The slow prompt segment: whether the git work tree has changes.
+ *
+ * It is computed by "git status" in a child process while the prompt is already shown.
+ * The result is kept per directory, so the next prompt in the same directory shows the
+ * last known state right away. Only whether git printed anything matters, so the child
+ * is stopped as soon as its first byte arrives. The child is reaped by the SIGCHLD handler.
+ */
+static struct
+{
+    pid_t pid;                /**< The running git status, or 0. */
+    int fd;                   /**< The read end of its output, or -1. */
+    char pending[PATH_MAX];   /**< The directory it runs in. */
+    char directory[PATH_MAX]; /**< The directory of the last result, empty if there is none. */
+    bool dirty;               /**< The last result. */
+} segment = {.fd = -1};
+
+/**
+ * Starts computing the dirty state of the work tree the shell is in.
+ *
+ * @param directory The current directory.
+ * @return The file descriptor to poll for the result, or -1 if it could not be started.
+ */
+int segment_start(const char *directory)
+{
+    static char *args[] = {"git", "--no-optional-locks", "status", "--porcelain", "--untracked-files=no", NULL};
+    posix_spawn_file_actions_t actions;
+    int pipefd[2];
+
+    segment_cancel();
+
+    if (pipe2(pipefd, O_CLOEXEC | O_NONBLOCK) == -1)
+    {
+        return -1;
+    }
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    int err = posix_spawnp(&segment.pid, "git", &actions, NULL, args, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipefd[1]);
+
+    if (err != 0)
+    {
+        close(pipefd[0]);
+        segment.pid = 0;
+        return -1;
+    }
+
+    segment.fd = pipefd[0];
+    snprintf(segment.pending, sizeof(segment.pending), "%s", directory);
+    return segment.fd;
+}
+
+/**
+ * Reads the output of the running git status, once its file descriptor is readable.
+ *
+ * @return true if the result is known, the dirty state may then have changed.
+ */
+bool segment_update(void)
+{
+    char byte;
+
+    if (segment.fd == -1)
+    {
+        return false;
+    }
+
+    ssize_t n = read(segment.fd, &byte, 1);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return false;
+    }
+
+    // Any output means changes, no output (or a failure) means a clean tree
+    segment.dirty = n > 0;
+    if (n <= 0)
+    {
+        segment.pid = 0; // it has exited, there is nothing left to stop
+    }
+    snprintf(segment.directory, sizeof(segment.directory), "%s", segment.pending);
+    segment_cancel();
+    return true;
+}
+
+/**
+ * Stops the running git status, if any. The last result is kept.
+ */
+void segment_cancel(void)
+{
+    if (segment.pid > 0)
+    {
+        kill(segment.pid, SIGTERM);
+        segment.pid = 0;
+    }
+
+    if (segment.fd != -1)
+    {
+        close(segment.fd);
+        segment.fd = -1;
+    }
+}
+
+/**
+ * Returns the last known dirty state of the work tree of a directory.
+ *
+ * @param directory The directory.
+ * @return SEGMENT_DIRTY_MARK if it had changes, an empty string if it had none or is not known yet.
+ */
+const char *segment_dirty(const char *directory)
+{
+    return segment.dirty && strcmp(segment.directory, directory) == 0 ? SEGMENT_DIRTY_MARK : "";
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+/***************************************************************************/ /**
+   @file         segment.h
+   @author       Jonathan Kuug & Abdul Wahab Abass
+   @date         April 2024
+   @brief        DSH (Dash Shell - Minimal Shell)
+ *******************************************************************************/
+
+// Library Imports
+#include <stdbool.h>
+
+// Macros
+#define SEGMENT_DIRTY_MARK "*" // Shown after the branch when the work tree has changes
+
+// Function Prototypes
+int segment_start(const char *directory);
+bool segment_update(void);
+void segment_cancel(void);
+const char *segment_dirty(const char *directory);
@@ -17,15 +17,18 @@
 #define MAX_ARGS 64
 
 /**
- * Initializes a buffer by allocating memory for the buffer and command list.
+ * Initializes a buffer by allocating memory for the line arena and command list.
  *
  * @return A pointer to the initialized buffer.
  */
 buff_t *init_buffer()
 {
     buff_t *buffer = (buff_t *)malloc(sizeof(buff_t));
-    buffer->buffer = malloc(MAX_BUFFER_SIZE);
-    buffer->command_list = (Command **)malloc(sizeof(Command *) * MAX_ARGS);
+    buffer->buffer = NULL;
+    buffer->arena = init_arena();
+    buffer->tokens = NULL;
+    buffer->token_count = 0;
+    buffer->command_list = (Command **)calloc(MAX_ARGS, sizeof(Command *));
     return buffer;
 }
 
@@ -47,10 +50,38 @@ app_t *init_app()
     app->current_directory = (char *)malloc(1024);
     app->current_directory_length = 1024;
     app->config = init_config();
+    app->last_status = 0;
+    app->pipe_status = (int *)malloc(sizeof(int) * MAX_PIPELINE_STAGES);
+    app->pipe_status_length = 0;
+    app->pipe_status_capacity = MAX_PIPELINE_STAGES;
+    app->interactive = false;
+    app->shell_pgid = 0;
 
     return app;
 }
 
+/**
+ * Sets the number of stages of the last pipeline, growing the statuses to hold them.
+ *
+ * @param app The app object.
+ * @param length The number of stages.
+ */
+void set_pipe_status_length(app_t *app, int length)
+{
+    if (length > app->pipe_status_capacity)
+    {
+        int *pipe_status = (int *)realloc(app->pipe_status, sizeof(int) * length);
+        if (pipe_status == NULL)
+        {
+            perror("Error allocating memory for pipeline statuses");
+            exit(EXIT_FAILURE);
+        }
+        app->pipe_status = pipe_status;
+        app->pipe_status_capacity = length;
+    }
+    app->pipe_status_length = length;
+}
+
 /**
  * Initializes a command buffer.
  *
@@ -88,6 +119,13 @@ config_t *init_config()
     config->historyFile = NULL;
     config->historySize = 0;
     config->editor = NULL;
+    config->processSpawn = true;
+    config->scriptCache = true;
+    config->pipeBufferSize = 0;
+    config->promptGitStatus = false;
+    config->profileFile = NULL;
+    config->profileFormat = NULL;
+    config->historyFormat = NULL;
 
     return config;
 }
@@ -98,16 +136,12 @@ config_t *init_config()
  * @param type The type of the command.
  * @param args The arguments of the command.
  * @param args_length The length of the arguments array.
- * @return A pointer to the newly created Command struct, or NULL if memory allocation fails.
+ * @param arena The arena the command is allocated from.
+ * @return A pointer to the newly created Command struct.
  */
-Command *new_command(command_t type, char **args, int args_length)
+Command *new_command(command_t type, char **args, int args_length, arena_t *arena)
 {
-    Command *new_command = (Command *)malloc(sizeof(Command));
-    if (new_command == NULL)
-    {
-        fprintf(stderr, "Failed to allocate memory for new command.\n");
-        return NULL;
-    }
+    Command *new_command = (Command *)arena_alloc(arena, sizeof(Command));
 
     new_command->type = type;
     new_command->args = args;
@@ -182,6 +216,42 @@ void load_config(const char *filename, config_t *config)
         {
             config->editor = strdup(value);
         }
+        else if (strcmp(key, "PROCESS_SPAWN") == 0)
+        {
+            config->processSpawn = strcmp(value, "true") == 0;
+        }
+        else if (strcmp(key, "SCRIPT_CACHE") == 0)
+        {
+            config->scriptCache = strcmp(value, "true") == 0;
+        }
+        else if (strcmp(key, "PIPE_BUFFER_SIZE") == 0)
+        {
+            long size = parse_size(value);
+            if (size < 0)
+            {
+                fprintf(stderr, "Invalid PIPE_BUFFER_SIZE: %s\n", value);
+            }
+            else
+            {
+                config->pipeBufferSize = size;
+            }
+        }
+        else if (strcmp(key, "PROMPT_GIT_STATUS") == 0)
+        {
+            config->promptGitStatus = strcmp(value, "true") == 0;
+        }
+        else if (strcmp(key, "PROFILE_FILE") == 0)
+        {
+            config->profileFile = strdup(value);
+        }
+        else if (strcmp(key, "PROFILE_FORMAT") == 0)
+        {
+            config->profileFormat = strdup(value);
+        }
+        else if (strcmp(key, "HISTORY_FORMAT") == 0)
+        {
+            config->historyFormat = strdup(value);
+        }
     }
 
     fclose(file);
@@ -10,10 +10,12 @@
 // Library Imports
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/types.h>
 #include "utils.h"
 
 // Macros
 #define MAX_COMMANDS_SIZE 4096
+#define MAX_PIPELINE_STAGES 64 // Stages a pipeline holds before its pids and statuses are grown
 
 /**
  * @brief Structure representing the configuration settings for the shell.
@@ -27,6 +29,13 @@ typedef struct Config
     char *historyFile;  /**< The file to store command history. */
     int historySize;    /**< The maximum number of commands to store in history. */
     char *editor;       /**< The default text editor for the shell. */
+    bool processSpawn;  /**< Whether to launch commands with posix_spawn instead of fork. */
+    bool scriptCache;   /**< Whether to cache parsed scripts between runs. */
+    long pipeBufferSize; /**< The buffer size of pipes between pipeline stages, 0 for the kernel default. */
+    bool promptGitStatus; /**< Whether the prompt shows if the git work tree has changes. */
+    char *profileFile;   /**< The file to write per-phase timings to, NULL to disable profiling. */
+    char *profileFormat; /**< The format of the profile, "jsonl" or "chrome". */
+    char *historyFormat; /**< The format of the history file, "text" or "binary". */
 } config_t;
 
 /**
@@ -71,18 +80,46 @@ typedef struct Command
     struct Command *next;
 } Command;
 
+/**
+ * @brief Structure representing the redirections of a command.
+ *
+ * Both arrays are indexed by the redirected file descriptor (stdin, stdout or stderr).
+ * A NULL path means the file descriptor is not redirected.
+ */
+typedef struct Redirects
+{
+    const char *path[3]; /**< The file each descriptor is redirected to. */
+    int flags[3];        /**< The open() flags for each redirected file. */
+} redirects_t;
+
+/**
+ * @brief Structure describing how a pipeline stage is connected, used when starting its process.
+ */
+typedef struct Stage
+{
+    int in_fd;       /**< The file descriptor to use as standard input. */
+    int out_fd;      /**< The file descriptor to use as standard output. */
+    int err_fd;      /**< The file descriptor to use as standard error. */
+    int read_fd;     /**< A file descriptor to close in the child, or -1. */
+    pid_t pgid;      /**< The process group to join, 0 to lead a new one, -1 without job control. */
+    bool foreground; /**< Whether the stage's job gets the terminal. */
+} stage_t;
+
 /**
  * @brief Structure representing an input buffer.
  *
  * This structure holds information about an input buffer, including the buffer itself,
- * the parsed arguments, the token list, the command list, and the lengths of the buffer
- * and input.
+ * the parsed arguments, the token array, the command list, and the lengths of the buffer
+ * and input. Everything produced for an input line is allocated from the buffer's arena
+ * and released in one step once the line has been executed.
  */
 typedef struct InputBuffer
 {
     char *buffer;
+    arena_t *arena;
     char *args[64];
-    Token *token_list;
+    Token *tokens;
+    size_t token_count;
     Command **command_list;
     size_t buffer_length;
     size_t input_length;
@@ -94,8 +131,8 @@ typedef struct InputBuffer
  * The `app_t` struct holds information about the current state of the application.
  * It includes a buffer for storing application data, a command buffer for storing
  * command-related data, the type of the current command, the length of the current
- * directory path, the current directory path itself, and a flag indicating whether
- * the application has been initialized.
+ * directory path, the current directory path itself, a flag indicating whether
+ * the application has been initialized, and the exit statuses of the last pipeline.
  */
 typedef struct AppState
 {
@@ -106,13 +143,20 @@ typedef struct AppState
     config_t *config;
     char *current_directory;
     bool has_init;
+    int last_status;                        /**< Exit status of the last pipeline ($?). */
+    int *pipe_status;                       /**< Exit status of each stage of the last pipeline. */
+    int pipe_status_length;                 /**< Number of stages of the last pipeline. */
+    int pipe_status_capacity;               /**< Number of statuses pipe_status can hold. */
+    bool interactive;                       /**< Whether job control is on (stdin is a terminal). */
+    pid_t shell_pgid;                       /**< The process group of the shell. */
 
 } app_t;
 
 // App utils
 buff_t *init_buffer();
 app_t *init_app();
+void set_pipe_status_length(app_t *app, int length);
 config_t *init_config();
 cmdBuffer_t *init_cmd_buffer();
-Command *new_command(command_t type, char **args, int args_length);
+Command *new_command(command_t type, char **args, int args_length, arena_t *arena);
 void load_config(const char *filename, config_t *config);
\ No newline at end of file
@@ -12,24 +12,74 @@
 #include "utils.h"
 
 /**
- * Creates a new token with the given value.
+ * Checks whether a character separates tokens.
  *
- * @param value The value of the token.
- * @return A pointer to the newly created token.
+ * @param c The character to check.
+ * @return true if the character is a delimiter, false otherwise.
  */
-Token *new_token(char *value)
+static bool is_delimiter(char c)
 {
-    Token *token = malloc(sizeof(Token));
-    token->value = strdup(value);
-    token->next = NULL;
-    return token;
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\a';
 }
 
 /**
- * Tokenizes the input string based on the given delimiters and stores the tokens in a linked list.
+ * @brief Operator lookup tables, indexed by the first byte of a token.
+ *
+ * Every operator is one or two bytes long and no two 2-byte operators share a first byte,
+ * so classifying a token is one table load plus at most one byte comparison.
+ * TOKEN_WORD (0) marks bytes that do not start an operator.
+ */
+static const token_t single_byte_operators[256] = {
+    ['|'] = TOKEN_PIPE,
+    ['<'] = TOKEN_REDIRECT_IN,
+    ['>'] = TOKEN_REDIRECT_OUT,
+    ['&'] = TOKEN_BACKGROUND,
+    [';'] = TOKEN_SEQUENCE,
+};
+
+static const struct
+{
+    char second;  /**< The second byte of the operator. */
+    token_t kind; /**< The kind of the operator. */
+} double_byte_operators[256] = {
+    ['2'] = {'>', TOKEN_REDIRECT_ERR},
+    ['>'] = {'>', TOKEN_REDIRECT_APP},
+    ['&'] = {'&', TOKEN_CONDITIONAL},
+};
+
+/**
+ * Classifies a token as an operator or a word, using the first byte and the length of the token.
+ *
+ * @param value The value of the token (does not need to be NUL terminated).
+ * @param length The length of the token's value.
+ * @return The kind of the token.
+ */
+token_t classify_operator(const char *value, size_t length)
+{
+    unsigned char first = (unsigned char)value[0];
+
+    if (length == 1)
+    {
+        return single_byte_operators[first];
+    }
+
+    if (length == 2 && double_byte_operators[first].kind != TOKEN_WORD && double_byte_operators[first].second == value[1])
+    {
+        return double_byte_operators[first].kind;
+    }
+
+    return TOKEN_WORD;
+}
+
+/**
+ * Tokenizes the input string based on the given delimiters in a single pass.
+ * Tokens are terminated in place and returned as slices of the input, operators are
+ * classified while scanning.
  *
  * @param input The input string to be tokenized.
- * @param args  A pointer to a Token pointer, which will be updated to point to the head of the linked list of tokens.
+ * @param tokens A pointer to a Token pointer, which will be updated to point to the token array.
+ * @param arena The arena the token array is allocated from.
+ * @return The number of tokens.
  */
 
 // void tokenize(char *input, Token **args)
@@ -60,81 +110,116 @@ Token *new_token(char *value)
 //     *args = head;
 // }
 
-void tokenize(char *input, Token **args)
+size_t tokenize(char *input, Token **tokens, arena_t *arena)
 {
+    *tokens = NULL;
+
     if (input == NULL)
     {
-        return;
+        return 0;
     }
 
-    char *token_value;
-    Token *head = NULL;
-    Token *current = NULL;
-
-    char *start_ptr = input;
-    char *end_ptr = input;
+    // Every token is at least one character followed by a delimiter (or an empty quoted string),
+    // so this bounds the token count and the array is allocated once
+    size_t length = strlen(input);
+    Token *list = arena_alloc(arena, sizeof(Token) * (length / 2 + 1));
+    size_t count = 0;
+    size_t i = 0;
 
-    while (*end_ptr != '\0')
+    while (i < length)
     {
-        if (*start_ptr == '"')
+        if (is_delimiter(input[i]))
         {
-            end_ptr = strchr(start_ptr + 1, '"');
-            if (end_ptr != NULL)
-            {
-                *end_ptr = '\0';
-                token_value = start_ptr + 1;
-                end_ptr++;
-            }
-            else
+            i++;
+            continue;
+        }
+
+        size_t start;
+        size_t end;
+        token_t kind;
+
+        if (input[i] == '"')
+        {
+            // Quoted tokens are always words, if there's no matching end quote the rest of the line is the token
+            start = end = i + 1;
+            while (end < length && input[end] != '"')
             {
-                // If there's no matching end quote, treat the rest of the string as a single token
-                token_value = start_ptr + 1;
-                end_ptr = start_ptr + strlen(start_ptr);
+                end++;
             }
+            kind = TOKEN_WORD;
         }
         else
         {
-            end_ptr = strpbrk(start_ptr, " \t\r\n\a");
-            if (end_ptr != NULL)
+            start = end = i;
+            while (end < length && !is_delimiter(input[end]))
             {
-                *end_ptr = '\0';
-                token_value = start_ptr;
-                end_ptr++;
-            }
-            else
-            {
-                // If there's no more delimiters, treat the rest of the string as a single token
-                token_value = start_ptr;
-                end_ptr = start_ptr + strlen(start_ptr);
+                end++;
             }
+            kind = classify_operator(input + start, end - start);
         }
 
-        if (head == NULL)
-        {
-            head = new_token(token_value);
-            current = head;
-        }
-        else
-        {
-            current->next = new_token(token_value);
-            current = current->next;
-        }
+        input[end] = '\0';
+        list[count].offset = start;
+        list[count].length = end - start;
+        list[count].kind = kind;
+        count++;
 
-        start_ptr = end_ptr;
+        i = end + 1;
     }
 
-    *args = head;
+    *tokens = list;
+    return count;
 }
 
 /**
- * Prints the values of each token in a linked list.
+ * Prints the values of each token in a token array.
  *
- * @param head The head of the linked list of tokens.
+ * @param input The tokenized input line.
+ * @param tokens The token array.
+ * @param count The number of tokens.
  */
-void printTokens(Token *head)
+void printTokens(const char *input, Token *tokens, size_t count)
 {
-    for (Token *current = head; current != NULL; current = current->next)
+    for (size_t i = 0; i < count; i++)
     {
-        printf("%s\n", current->value);
+        printf("%s\n", input + tokens[i].offset);
     }
 }
+
+/**
+ * Parses a size such as "65536", "256K" or "1M".
+ *
+ * @param value The size, in bytes or with a K, M or G suffix.
+ * @return The size in bytes, or -1 if the value is not a valid size.
+ */
+long parse_size(const char *value)
+{
+    char *end;
+    long size = strtol(value, &end, 10);
+
+    if (end == value || size < 0)
+    {
+        return -1;
+    }
+
+    switch (*end)
+    {
+    case 'k':
+    case 'K':
+        size <<= 10;
+        end++;
+        break;
+    case 'm':
+    case 'M':
+        size <<= 20;
+        end++;
+        break;
+    case 'g':
+    case 'G':
+        size <<= 30;
+        end++;
+        break;
+    }
+
+    return *end == '\0' ? size : -1;
+}
@@ -7,19 +7,42 @@
    @brief        DSH (Dash Shell - Minimal Shell)
  *******************************************************************************/
 
+// Library Imports
+#include <stddef.h>
+#include "arena.h"
+
+/**
+ * @brief Enumeration representing the kinds of tokens produced by the tokenizer.
+ */
+typedef enum TokenKind
+{
+  TOKEN_WORD,           // Command name or argument
+  TOKEN_PIPE,           // "|"
+  TOKEN_REDIRECT_IN,    // "<"
+  TOKEN_REDIRECT_OUT,   // ">"
+  TOKEN_REDIRECT_ERR,   // "2>"
+  TOKEN_REDIRECT_APP,   // ">>"
+  TOKEN_BACKGROUND,     // "&"
+  TOKEN_SEQUENCE,       // ";"
+  TOKEN_CONDITIONAL     // "&&"
+} token_t;
+
 /**
  * @struct Token
  * @brief Represents a token in a shell command.
  *
- * The Token struct contains a string value and a pointer to the next token in the command.
+ * The Token struct is a slice of the input line: the tokenizer terminates every token
+ * in place, so the token's value is the NUL terminated string at input + offset.
  */
 typedef struct Token
 {
-  char *value;        /**< The string value of the token. */
-  struct Token *next; /**< Pointer to the next token in the command. */
+  size_t offset; /**< The offset of the token's value in the input line. */
+  size_t length; /**< The length of the token's value. */
+  token_t kind;  /**< The kind of the token, operators are classified while scanning. */
 } Token;
 
 // Function Prototypes
-Token *createToken(char *value);
-void tokenize(char *input, Token **args);
-void printTokens(Token *head);
\ No newline at end of file
+token_t classify_operator(const char *value, size_t length);
+size_t tokenize(char *input, Token **tokens, arena_t *arena);
+void printTokens(const char *input, Token *tokens, size_t count);
+long parse_size(const char *value);